@@ -0,0 +1,525 @@
+#include "common.hpp"
+#include "utility.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+#include "solver_stats.hpp"
+#include "puzzle_file.hpp"
+#include "rng.hpp"
+#include "minimizer.hpp"
+#include "batch_solver.hpp"
+#include "portfolio.hpp"
+#include "parallel_search.hpp"
+#include "generator.hpp"
+#include "component_count.hpp"
+#include "logical_solver.hpp"
+#include "grid_table.hpp"
+#include "solution_validator.hpp"
+#include "puzzle_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+// Regions for a board made of square boxes, e.g. 3x3 boxes on a 9x9 board
+auto box_regions(u64 box) -> std::vector<std::string>
+{
+    const auto size = box * box;
+    auto rows = std::vector<std::string>(size, std::string(size, '0'));
+    for (u64 y = 0; y != size; ++y) {
+        for (u64 x = 0; x != size; ++x) {
+            rows[y][x] = to_symbol(static_cast<i32>((y / box) * box + x / box));
+        }
+    }
+    return rows;
+}
+
+auto make_from_rows(const std::vector<std::string>& cells, const std::vector<std::string>& regions) -> sudoku_board
+{
+    return sudoku_board::make_board(
+        std::vector<std::string_view>(cells.begin(), cells.end()),
+        std::vector<std::string_view>(regions.begin(), regions.end())
+    );
+}
+
+template <typename Func>
+auto time_ms(Func&& func) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Fills an empty board of the given box size and blanks out a proportion of the cells
+auto bench_puzzle(u64 box, float blank_ratio) -> std::optional<sudoku_board>
+{
+    const auto size = box * box;
+    const auto regions = box_regions(box);
+
+    auto rows = std::vector<std::string>(size, std::string(size, '.'));
+    const auto filled = solve(make_from_rows(rows, regions));
+    if (!filled) return {};
+
+    for (u64 y = 0; y != size; ++y) {
+        for (u64 x = 0; x != size; ++x) {
+            if (random_unit() >= blank_ratio) rows[y][x] = to_symbol((*filled)[x + y * size]);
+        }
+    }
+    return make_from_rows(rows, regions);
+}
+
+// The same as bench_puzzle for a Samurai, five 9x9 grids sharing their corner boxes
+auto bench_samurai_puzzle(float blank_ratio) -> std::optional<sudoku_board>
+{
+    const auto size = u64{21};
+    const auto empty = sudoku_board::make_multi_board({}, 9, samurai_grids());
+    const auto filled = solve(empty);
+    if (!filled) return {};
+
+    auto rows = std::vector<std::string>(size, std::string(size, ' '));
+    for (u64 y = 0; y != size; ++y) {
+        for (u64 x = 0; x != size; ++x) {
+            const auto value = (*filled)[x + y * size];
+            if (value) rows[y][x] = random_unit() >= blank_ratio ? to_symbol(value) : '.';
+        }
+    }
+    return sudoku_board::make_multi_board(std::vector<std::string_view>(rows.begin(), rows.end()), 9, samurai_grids());
+}
+
+// Times how long solving, checking uniqueness and checking the filled grid take
+auto bench_board(std::string_view label, const sudoku_board& puzzle) -> void
+{
+    auto result = std::optional<solution>{};
+    const auto solve_ms = time_ms([&] { result = solve(puzzle); });
+
+    auto count = u64{0};
+    const auto unique_ms = time_ms([&] { count = count_solutions(puzzle, 2); });
+
+    auto solved = false;
+    const auto check_ms = time_ms([&] { solved = is_solved(puzzle.with_values(*result)); });
+
+    std::print("{} cells={:<4} solve={:.3f}ms unique={:.3f}ms ({}) check={:.3f}ms ({})\n",
+        label, std::ranges::count_if(puzzle.cells(), &sudoku_cell::active), solve_ms, unique_ms, count == 1 ? "unique" : "multiple",
+        check_ms, solved ? "ok" : "bad");
+}
+
+auto run_bench(u64 seed) -> int
+{
+    struct bench_case
+    {
+        u64                         box; // 0 for a Samurai
+        float                       blank_ratio;
+        std::optional<sudoku_board> puzzle;
+    };
+    auto cases = std::vector<bench_case>{};
+    for (const auto box : {3, 4, 5}) {
+        for (const auto blank_ratio : {0.5f, 0.65f}) cases.push_back({static_cast<u64>(box), blank_ratio, {}});
+    }
+    for (const auto blank_ratio : {0.5f, 0.65f}) cases.push_back({0, blank_ratio, {}});
+
+    // The boards are made in parallel, each on a thread with its own stream of the seed,
+    // so they come out the same on every run however the threads are scheduled. The
+    // timings then run one at a time.
+    seed_random(seed);
+    {
+        auto workers = std::vector<std::jthread>{};
+        for (std::size_t i = 0; i != cases.size(); ++i) {
+            workers.emplace_back([&cases, i] {
+                seed_thread(i + 1);
+                auto& c = cases[i];
+                c.puzzle = c.box ? bench_puzzle(c.box, c.blank_ratio) : bench_samurai_puzzle(c.blank_ratio);
+            });
+        }
+    }
+
+    for (const auto& c : cases) {
+        const auto size = c.box * c.box;
+        const auto label = c.box ? std::format("{0:>2}x{0:<2}", size) : std::string{"samurai"};
+        if (c.puzzle) {
+            bench_board(label, *c.puzzle);
+        } else {
+            std::print("{}: failed to fill an empty board\n", label);
+        }
+    }
+    return 0;
+}
+
+auto write_stats(const solver_stats& stats, std::string_view path) -> void
+{
+    if (path == "-") {
+        std::print("{}", stats.to_json());
+        return;
+    }
+    auto file = std::ofstream{std::string{path}};
+    file << stats.to_json();
+    std::print("wrote solver stats to {}\n", path);
+}
+
+auto run_solve(std::string_view path, std::optional<std::string_view> stats_path) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    auto stats = solver_stats{};
+    auto result = std::optional<solution>{};
+    auto count = u64{0};
+    {
+        auto scope = std::optional<stats_scope>{};
+        if (stats_path) scope.emplace(stats);
+        result = solve(*board);
+        count = count_solutions(*board, 2);
+    }
+
+    if (!result) {
+        std::print("no solution\n");
+    } else {
+        const auto size = board->size();
+        for (u64 y = 0; y != size; ++y) {
+            for (u64 x = 0; x != size; ++x) {
+                const auto value = (*result)[x + y * size];
+                std::print("{}", value ? to_symbol(value) : ' '); // 0 is outside every grid
+            }
+            std::print("\n");
+        }
+        std::print("{}\n", count == 1 ? "unique" : "multiple solutions");
+    }
+
+    if (stats_path) write_stats(stats, *stats_path);
+    return result ? 0 : 2;
+}
+
+auto print_board(const sudoku_board& board) -> void
+{
+    const auto size = board.size();
+    for (u64 y = 0; y != size; ++y) {
+        for (u64 x = 0; x != size; ++x) {
+            const auto& cell = board.at({x, y});
+            std::print("{}", cell.value ? to_symbol(*cell.value) : cell.active ? '.' : ' ');
+        }
+        std::print("\n");
+    }
+}
+
+// Solves the puzzle in the file and then strips it back down to a minimal set of givens
+auto run_minimize(std::string_view path, u64 seed, u64 threads) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    const auto filled = solve(*board);
+    if (!filled) {
+        std::print("no solution\n");
+        return 2;
+    }
+
+    auto puzzle = std::optional<sudoku_board>{};
+    const auto ms = time_ms([&] { puzzle = minimize_clues(board->with_values(*filled), seed, threads); });
+
+    const auto givens = std::ranges::count_if(puzzle->cells(), [](const auto& cell) { return cell.value.has_value(); });
+    print_board(*puzzle);
+    std::print("{} givens in {:.3f}ms\n", givens, ms);
+    return 0;
+}
+
+// Solves a file of 9x9 puzzles on standard boxes, one 81 character puzzle per line
+auto run_batch(std::string_view path) -> int
+{
+    auto file = std::ifstream{std::string{path}};
+    if (!file) {
+        std::print("could not open {}\n", path);
+        return 1;
+    }
+
+    auto lines = std::vector<std::string>{};
+    for (auto line = std::string{}; std::getline(file, line);) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.size() >= 81) lines.push_back(line);
+    }
+    const auto puzzles = std::vector<std::string_view>(lines.begin(), lines.end());
+    const auto layout = make_from_rows(std::vector<std::string>(9, std::string(9, '.')), box_regions(3));
+
+    auto stats = solver_stats{};
+    auto results = std::vector<std::optional<solution>>{};
+    const auto ms = time_ms([&] {
+        const auto scope = stats_scope{stats};
+        results = solve_batch(layout, puzzles);
+    });
+
+    const auto solved = std::ranges::count_if(results, [](const auto& r) { return r.has_value(); });
+    std::print("solved {}/{} puzzles in {:.3f}ms ({:.0f} per second), {} needed search\n",
+        solved, results.size(), ms, results.size() / (ms / 1000.0), stats.technique_hits.get("scalar_fallback"));
+    return 0;
+}
+
+// Prints the first few solutions of a puzzle without searching for the rest
+auto run_solutions(std::string_view path, u64 limit) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    u64 count = 0;
+    for (const auto& values : solutions(*board)) {
+        print_board(board->with_values(values));
+        std::print("\n");
+        if (++count == limit) break;
+    }
+    std::print("{} solutions shown\n", count);
+    return 0;
+}
+
+// Counts every solution of a puzzle, splitting it into independent parts as it goes
+auto run_count(std::string_view path) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    auto count = u64{0};
+    const auto ms = time_ms([&] { count = count_by_components(*board); });
+    if (count == u64_max) {
+        std::print("at least {} solutions in {:.3f}ms\n", count, ms);
+    } else {
+        std::print("{} solutions in {:.3f}ms\n", count, ms);
+    }
+    return 0;
+}
+
+// Checks a file of completed grids against the layout of a puzzle file
+auto run_validate(std::string_view layout_path, std::string_view grids_path) -> int
+{
+    const auto layout = load_puzzle(layout_path);
+    if (!layout) return 1;
+
+    auto report = std::optional<validation_report>{};
+    const auto ms = time_ms([&] { report = validate_file(*layout, grids_path); });
+    if (!report) return 1;
+
+    std::print("checked {} grids in {:.3f}ms ({:.0f} per second), {} invalid\n",
+        report->grids, ms, report->grids / (ms / 1000.0), report->invalid.size());
+    for (std::size_t i = 0; i != std::min<std::size_t>(report->invalid.size(), 20); ++i) std::print("    grid {}\n", report->invalid[i]);
+    if (report->invalid.size() > 20) std::print("    ...\n");
+    return report->invalid.empty() ? 0 : 2;
+}
+
+// Races every solver strategy on the puzzle and reports which one finished first
+auto run_race(std::string_view path) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    auto result = std::optional<portfolio_result>{};
+    const auto ms = time_ms([&] { result = solve_portfolio(*board); });
+
+    if (result->values) {
+        print_board(board->with_values(*result->values));
+    } else {
+        std::print("no solution\n");
+    }
+    std::print("{} won in {:.3f}ms\n", to_string(result->winner), ms);
+    return result->values ? 0 : 2;
+}
+
+// Splits the search of one puzzle across threads, stopping once a second solution shows
+// the puzzle isn't unique
+auto run_parallel(std::string_view path, u64 threads) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    auto result = parallel_result{};
+    const auto ms = time_ms([&] { result = search_parallel(*board, 2, {.threads = threads}); });
+
+    if (!result.first) {
+        std::print("no solution\n");
+        return 2;
+    }
+    print_board(board->with_values(*result.first));
+    std::print("{} in {:.3f}ms\n", result.found == 1 ? "unique" : "multiple", ms);
+    return 0;
+}
+
+// Solves a puzzle step by step without guessing and prints the deductions it needed
+auto run_rate(std::string_view path) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    auto stats = solver_stats{};
+    auto rating = logical_rating{};
+    const auto ms = time_ms([&] {
+        const auto scope = stats_scope{stats};
+        rating = rate_puzzle(*board);
+    });
+
+    for (const auto& [name, count] : stats.technique_hits) {
+        std::print("{:<16}{}\n", name, count);
+    }
+    std::print("{} in {} steps, hardest technique {}, {:.3f}ms\n",
+        rating.solved ? "solved" : "stuck", rating.steps, to_string(rating.hardest), ms);
+    return rating.solved ? 0 : 2;
+}
+
+// Solves, counts and rates a puzzle through a cache file shared between runs
+auto run_analyse(std::string_view cache_path, std::string_view path) -> int
+{
+    const auto board = load_puzzle(path);
+    if (!board) return 1;
+
+    // A new cache is sized for boards like this one
+    auto cache = puzzle_cache::open(cache_path, 1 << 16, board->cells().size());
+    if (!cache) return 1;
+
+    const auto cached = cache->find(*board).has_value();
+    auto analysis = puzzle_analysis{};
+    const auto ms = time_ms([&] { analysis = cache->analyse(*board); });
+
+    if (analysis.values) {
+        print_board(board->with_values(*analysis.values));
+        std::print("\n");
+    }
+    std::print("{}{} solutions, {} in {} steps, hardest technique {}\n", analysis.count == u64_max ? "at least " : "", analysis.count,
+        analysis.rating.solved ? "solved" : "stuck", analysis.rating.steps, to_string(analysis.rating.hardest));
+    std::print("{} in {:.3f}ms, {} of {} cache slots used\n", cached ? "cached" : "analysed", ms, cache->size(), cache->capacity());
+    return 0;
+}
+
+auto parse_technique(std::string_view name) -> std::optional<technique>
+{
+    for (auto t = technique::naked_single; t <= technique::pattern_overlay; t = static_cast<technique>(static_cast<u8>(t) + 1)) {
+        if (to_string(t) == name) return t;
+    }
+    std::print("unknown technique '{}'\n", name);
+    return {};
+}
+
+// Makes rated puzzles on the layout of the puzzle file whose hardest technique lies
+// between the two given
+auto run_generate(std::string_view path, std::string_view easiest, std::string_view hardest, u64 count, u64 seed) -> int
+{
+    const auto layout = load_puzzle(path);
+    const auto low = parse_technique(easiest);
+    const auto high = parse_technique(hardest);
+    if (!layout || !low || !high) return 1;
+
+    auto puzzles = std::vector<generated_puzzle>{};
+    const auto ms = time_ms([&] {
+        puzzles = generate_puzzles(*layout, {.band = {*low, *high}, .count = count, .max_attempts = 100 * count, .seed = seed});
+    });
+
+    for (const auto& puzzle : puzzles) {
+        print_board(puzzle.board);
+        const auto givens = std::ranges::count_if(puzzle.board.cells(), [](const auto& cell) { return cell.value.has_value(); });
+        std::print("# {} givens, {} steps, hardest technique {}\n\n", givens, puzzle.rating.steps, to_string(puzzle.rating.hardest));
+    }
+    std::print("{} of {} puzzles in {:.3f}ms\n", puzzles.size(), count, ms);
+    return puzzles.size() == count ? 0 : 2;
+}
+
+// Enumerates every grid of the layout in the puzzle file and writes them to a table
+auto run_enumerate(std::string_view layout_path, std::string_view out_path) -> int
+{
+    const auto layout = load_puzzle(layout_path);
+    if (!layout) return 1;
+
+    auto table = std::optional<grid_table>{};
+    const auto ms = time_ms([&] { table = grid_table::build(*layout); });
+    if (!table || !table->save(out_path)) return 1;
+
+    std::print("wrote {} grids to {} in {:.3f}ms\n", table->grid_count(), out_path, ms);
+    return 0;
+}
+
+// Answers a puzzle from a grid table and checks the answer against the solver
+auto run_lookup(std::string_view table_path, std::string_view puzzle_path) -> int
+{
+    const auto table = grid_table::load(table_path);
+    const auto board = load_puzzle(puzzle_path);
+    if (!table || !board) return 1;
+    if (!table->matches(*board)) {
+        std::print("{} was built for a different layout\n", table_path);
+        return 1;
+    }
+
+    auto table_count = u64{0};
+    const auto table_ms = time_ms([&] { table_count = table->count_solutions(*board); });
+    auto solver_count = u64{0};
+    const auto solver_ms = time_ms([&] { solver_count = count_solutions(*board); });
+
+    if (const auto values = table->solve(*board)) print_board(board->with_values(*values));
+    std::print("table: {} solutions in {:.3f}ms\n", table_count, table_ms);
+    std::print("solver: {} solutions in {:.3f}ms\n", solver_count, solver_ms);
+    if (table_count != solver_count) {
+        std::print("MISMATCH\n");
+        return 2;
+    }
+    return 0;
+}
+
+auto print_usage() -> int
+{
+    std::print("usage: sudoku_cli <command>\n");
+    std::print("commands:\n");
+    std::print("    bench [seed]                       time solving and checking 9x9, 16x16, 25x25 and Samurai boards\n");
+    std::print("    solve <file> [--stats <out.json>]  solve a puzzle file, '-' writes the stats to stdout\n");
+    std::print("    minimize <file> [seed] [threads]   solve a puzzle file and remove givens until minimal\n");
+    std::print("    batch <file>                       solve a file of 9x9 puzzles, one per line\n");
+    std::print("    solutions <file> [limit]           print solutions of a puzzle, 10 by default\n");
+    std::print("    count <file>                       count every solution of a puzzle\n");
+    std::print("    race <file>                        solve a puzzle with every strategy at once\n");
+    std::print("    parallel <file> [threads]          solve a puzzle and check it is unique on many threads\n");
+    std::print("    rate <file>                        solve a puzzle without guessing and rate it\n");
+    std::print("    generate <file> <easiest> <hardest> [count] [seed]\n");
+    std::print("                                       make puzzles on a layout rated between two techniques\n");
+    std::print("    enumerate <file> <out>             write every grid of a 4x4 or 6x6 layout to a table\n");
+    std::print("    lookup <table> <file>              count a puzzle's solutions from a table and the solver\n");
+    std::print("    validate <file> <grids>            check a file of completed grids against a puzzle's layout\n");
+    std::print("    analyse <cache> <file>             solve, count and rate a puzzle, reusing earlier results\n");
+    return 1;
+}
+
+}
+}
+
+auto main(int argc, char** argv) -> int
+{
+    using namespace sudoku;
+
+    if (argc < 2) return print_usage();
+    const auto command = std::string_view{argv[1]};
+
+    if (command == "bench") return run_bench(argc >= 3 ? std::stoull(argv[2]) : 0);
+    if (command == "solve" && argc >= 3) {
+        auto stats_path = std::optional<std::string_view>{};
+        if (argc >= 5 && std::string_view{argv[3]} == "--stats") stats_path = argv[4];
+        return run_solve(argv[2], stats_path);
+    }
+    if (command == "batch" && argc >= 3) return run_batch(argv[2]);
+    if (command == "count" && argc >= 3) return run_count(argv[2]);
+    if (command == "race" && argc >= 3) return run_race(argv[2]);
+    if (command == "parallel" && argc >= 3) return run_parallel(argv[2], argc >= 4 ? std::stoull(argv[3]) : 0);
+    if (command == "rate" && argc >= 3) return run_rate(argv[2]);
+    if (command == "generate" && argc >= 5) {
+        const auto count = argc >= 6 ? std::stoull(argv[5]) : 1;
+        const auto seed = argc >= 7 ? std::stoull(argv[6]) : 0;
+        return run_generate(argv[2], argv[3], argv[4], count, seed);
+    }
+    if (command == "enumerate" && argc >= 4) return run_enumerate(argv[2], argv[3]);
+    if (command == "lookup" && argc >= 4) return run_lookup(argv[2], argv[3]);
+    if (command == "validate" && argc >= 4) return run_validate(argv[2], argv[3]);
+    if (command == "analyse" && argc >= 4) return run_analyse(argv[2], argv[3]);
+    if (command == "solutions" && argc >= 3) return run_solutions(argv[2], argc >= 4 ? std::stoull(argv[3]) : 10);
+    if (command == "minimize" && argc >= 3) {
+        const auto seed = argc >= 4 ? std::stoull(argv[3]) : 0;
+        const auto threads = argc >= 5 ? std::stoull(argv[4]) : 0;
+        return run_minimize(argv[2], seed, threads);
+    }
+    return print_usage();
+}
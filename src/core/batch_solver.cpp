@@ -0,0 +1,178 @@
+#include "batch_solver.hpp"
+#include "solver_stats.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace sudoku {
+namespace {
+
+static constexpr u64 batch_cells = 81;
+static constexpr u16 batch_full = 0x1ff;
+
+// Candidates are stored cell-major with one u16 per lane, so every loop over the lanes is
+// a fixed-length loop over contiguous u16s that the compiler turns into vector code. Lane
+// flags are u16s too, all ones for true, so the loops never mix element widths.
+using lane_masks = std::array<u16, batch_lanes>;
+
+struct lane_group
+{
+    std::array<lane_masks, batch_cells> candidates;
+    lane_masks                          failed = {};
+};
+
+auto is_single(u16 mask) -> bool
+{
+    return (mask & (mask - 1)) == 0;
+}
+
+auto to_flag(bool value) -> u16
+{
+    return value ? 0xffff : 0;
+}
+
+auto any_progress(const lane_masks& changed, const lane_masks& failed) -> bool
+{
+    u16 any = 0;
+    for (u64 lane = 0; lane != batch_lanes; ++lane) any |= changed[lane] & ~failed[lane];
+    return any != 0;
+}
+
+// One sweep of naked singles: every unsolved cell drops the digits of its solved peers.
+// Returns true if any lane changed.
+auto sweep_naked(const sudoku_board& layout, lane_group& group) -> bool
+{
+    auto solved = std::array<lane_masks, batch_cells>{};
+    for (u64 cell = 0; cell != batch_cells; ++cell) {
+        for (u64 lane = 0; lane != batch_lanes; ++lane) {
+            const u16 mask = group.candidates[cell][lane];
+            solved[cell][lane] = mask & to_flag(is_single(mask));
+        }
+    }
+
+    auto changed = lane_masks{};
+    for (u64 cell = 0; cell != batch_cells; ++cell) {
+        auto taken = lane_masks{};
+        for (const auto peer : layout.peers(cell)) {
+            const auto& peer_solved = solved[peer];
+            for (u64 lane = 0; lane != batch_lanes; ++lane) taken[lane] |= peer_solved[lane];
+        }
+
+        auto& candidates = group.candidates[cell];
+        const auto& own = solved[cell];
+        for (u64 lane = 0; lane != batch_lanes; ++lane) {
+            const u16 mask = candidates[lane];
+            const u16 single = to_flag(own[lane] != 0);
+            const u16 next = (mask & single) | (mask & ~taken[lane] & ~single);
+            group.failed[lane] |= to_flag(next == 0) | (single & to_flag((mask & taken[lane]) != 0));
+            changed[lane] |= to_flag(next != mask);
+            candidates[lane] = next;
+        }
+    }
+    return any_progress(changed, group.failed);
+}
+
+// One sweep of hidden singles over every house. Returns true if any lane changed.
+auto sweep_hidden(const sudoku_board& layout, lane_group& group) -> bool
+{
+    auto changed = lane_masks{};
+    for (const auto& house : layout.houses()) {
+        auto once = lane_masks{};
+        auto twice = lane_masks{};
+        for (const auto cell : house) {
+            const auto& candidates = group.candidates[cell];
+            for (u64 lane = 0; lane != batch_lanes; ++lane) {
+                twice[lane] |= once[lane] & candidates[lane];
+                once[lane] |= candidates[lane];
+            }
+        }
+
+        auto hidden = lane_masks{};
+        for (u64 lane = 0; lane != batch_lanes; ++lane) {
+            group.failed[lane] |= to_flag(once[lane] != batch_full);
+            hidden[lane] = once[lane] & ~twice[lane];
+        }
+
+        for (const auto cell : house) {
+            auto& candidates = group.candidates[cell];
+            for (u64 lane = 0; lane != batch_lanes; ++lane) {
+                const u16 mask = candidates[lane];
+                const u16 found = mask & hidden[lane];
+                const u16 take = to_flag(found != 0) & ~to_flag(is_single(mask));
+                const u16 next = (found & take) | (mask & ~take);
+                changed[lane] |= to_flag(next != mask);
+                candidates[lane] = next;
+            }
+        }
+    }
+    return any_progress(changed, group.failed);
+}
+
+auto satisfies_constraints(const sudoku_board& layout, const solution& values) -> bool
+{
+    if (layout.constraints.empty()) return true;
+    const auto board = layout.with_values(values);
+    return std::ranges::all_of(layout.constraints, [&](const auto& c) { return c->check(board); });
+}
+
+auto load_lane(lane_group& group, u64 lane, std::string_view puzzle) -> void
+{
+    for (u64 cell = 0; cell != batch_cells; ++cell) {
+        const auto c = cell < puzzle.size() ? puzzle[cell] : '.';
+        group.candidates[cell][lane] = ('1' <= c && c <= '9') ? static_cast<u16>(1 << (c - '1')) : batch_full;
+    }
+}
+
+}
+
+auto solve_batch(const sudoku_board& layout, std::span<const std::string_view> puzzles) -> std::vector<std::optional<solution>>
+{
+    assert(layout.size() == 9);
+    auto results = std::vector<std::optional<solution>>(puzzles.size());
+    auto* stats = current_stats();
+    auto group = lane_group{};
+
+    for (std::size_t first = 0; first < puzzles.size(); first += batch_lanes) {
+        const auto count = std::min<std::size_t>(batch_lanes, puzzles.size() - first);
+
+        // Unused lanes in the last group repeat the first puzzle so they settle with it
+        group.failed = {};
+        for (u64 lane = 0; lane != batch_lanes; ++lane) {
+            load_lane(group, lane, puzzles[first + (lane < count ? lane : 0)]);
+        }
+
+        while (sweep_naked(layout, group) | sweep_hidden(layout, group)) {}
+
+        for (u64 lane = 0; lane != count; ++lane) {
+            if (group.failed[lane]) continue;
+
+            auto values = solution(batch_cells);
+            auto complete = true;
+            for (u64 cell = 0; cell != batch_cells; ++cell) {
+                const auto mask = group.candidates[cell][lane];
+                if (is_single(mask)) {
+                    values[cell] = lowest_digit(mask);
+                } else {
+                    values[cell] = 0;
+                    complete = false;
+                }
+            }
+
+            if (complete) {
+                // Propagation only used the houses, and the grid it forced is the only one
+                // they allow, so if it breaks a constraint the puzzle has no solution
+                if (satisfies_constraints(layout, values)) results[first + lane] = std::move(values);
+                if (stats) stats->technique_hits.add("lane_propagation", 1);
+            } else {
+                // The propagated singles are implied by the givens, so they are a valid start
+                results[first + lane] = solve(layout.with_values(values));
+                if (stats) stats->technique_hits.add("scalar_fallback", 1);
+            }
+        }
+    }
+
+    return results;
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sudoku {
+
+// Puzzles are solved in groups of this many, one per lane
+static constexpr u64 batch_lanes = 16;
+
+// Solves many 9x9 puzzles sharing the region layout of the given board. Each puzzle is 81
+// characters, '1'-'9' for givens and anything else for an empty cell. Groups of puzzles
+// run singles propagation in lockstep, and any puzzle that still needs to branch once the
+// group stops making progress is finished by the regular solver. Either way the layout's
+// constraints hold in every solution returned.
+auto solve_batch(const sudoku_board& layout, std::span<const std::string_view> puzzles) -> std::vector<std::optional<solution>>;
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+
+#include <array>
+#include <bit>
+
+namespace sudoku {
+
+// A set of cells on the largest supported board, one bit per cell index. The size is
+// fixed so sets can live in flat arrays and combine without allocating, and the word
+// loops are short enough for the compiler to unroll.
+class cell_bits
+{
+public:
+    static constexpr u64 words = (max_board_size * max_board_size + 63) / 64;
+
+private:
+    std::array<u64, words> d_words{};
+
+public:
+    auto set(u64 cell) -> void { d_words[cell / 64] |= u64{1} << (cell % 64); }
+    auto reset(u64 cell) -> void { d_words[cell / 64] &= ~(u64{1} << (cell % 64)); }
+    auto test(u64 cell) const -> bool { return (d_words[cell / 64] >> (cell % 64)) & 1; }
+
+    auto count() const -> u64
+    {
+        u64 total = 0;
+        for (const auto word : d_words) total += std::popcount(word);
+        return total;
+    }
+
+    auto any() const -> bool
+    {
+        u64 all = 0;
+        for (const auto word : d_words) all |= word;
+        return all != 0;
+    }
+
+    auto operator&=(const cell_bits& other) -> cell_bits&
+    {
+        for (u64 i = 0; i != words; ++i) d_words[i] &= other.d_words[i];
+        return *this;
+    }
+
+    auto operator|=(const cell_bits& other) -> cell_bits&
+    {
+        for (u64 i = 0; i != words; ++i) d_words[i] |= other.d_words[i];
+        return *this;
+    }
+
+    // Removes every cell in other
+    auto subtract(const cell_bits& other) -> cell_bits&
+    {
+        for (u64 i = 0; i != words; ++i) d_words[i] &= ~other.d_words[i];
+        return *this;
+    }
+
+    friend auto operator&(cell_bits a, const cell_bits& b) -> cell_bits { return a &= b; }
+    friend auto operator|(cell_bits a, const cell_bits& b) -> cell_bits { return a |= b; }
+    friend auto operator==(const cell_bits&, const cell_bits&) -> bool = default;
+
+    // Calls fn(cell) for every cell in the set, in increasing order
+    template <typename Func>
+    auto for_each(Func&& fn) const -> void
+    {
+        for (u64 i = 0; i != words; ++i) {
+            for (auto word = d_words[i]; word; word &= word - 1) {
+                fn(i * 64 + std::countr_zero(word));
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "common.hpp"
+
+#include <cassert>
+#include <compare>
+
+namespace sudoku {
+
+// A cell as its index x + y * size into the board's cell array. It is a quarter the size of
+// the glm::ivec2 position it stands for, which matters in edit histories and highlighted
+// cell sets, and being its own type it can't be mixed up with a digit or a house.
+class cell_index
+{
+    u16 d_value = 0;
+
+public:
+    constexpr cell_index() = default;
+    constexpr explicit cell_index(u64 value) : d_value{static_cast<u16>(value)}
+    {
+        assert(value <= std::numeric_limits<u16>::max());
+    }
+
+    constexpr auto value() const -> u16 { return d_value; }
+
+    constexpr auto operator<=>(const cell_index&) const = default;
+};
+
+}
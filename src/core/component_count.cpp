@@ -0,0 +1,223 @@
+#include "component_count.hpp"
+#include "hash128.hpp"
+#include "solver.hpp"
+#include "solver_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+// Once the cache holds this many groups it is emptied and starts again
+constexpr std::size_t cache_capacity = 1 << 20;
+
+auto saturating_add(u64 a, u64 b) -> u64
+{
+    return a > u64_max - b ? u64_max : a + b;
+}
+
+auto saturating_multiply(u64 a, u64 b) -> u64
+{
+    if (a == 0 || b == 0) return 0;
+    return a > u64_max / b ? u64_max : a * b;
+}
+
+auto is_open(const grid_state& state, u16 cell) -> bool
+{
+    return std::popcount(state.candidates[cell]) > 1;
+}
+
+class component_counter
+{
+    const sudoku_board&           d_board;
+    solver_stats*                 d_stats;
+    std::vector<std::vector<u16>> d_constraint_cells; // per constraint, the cells it reads
+    std::vector<std::vector<u16>> d_cell_constraints; // per cell, the constraints reading it
+
+    std::unordered_map<hash128, u64, hash128_hasher> d_cache; // by a hash of the group's state
+
+    // Scratch for walking groups, a cell belongs to the current walk if its mark is d_walk
+    std::vector<u32> d_mark;
+    u32              d_walk = 0;
+
+public:
+    explicit component_counter(const sudoku_board& board)
+        : d_board{board}
+        , d_stats{current_stats()}
+        , d_cell_constraints(board.cells().size())
+        , d_mark(board.cells().size(), 0)
+    {
+        for (std::size_t i = 0; i != board.constraints.size(); ++i) {
+            auto& cells = d_constraint_cells.emplace_back();
+            for (const auto pos : board.constraints[i]->cells()) {
+                const auto cell = static_cast<u16>(pos.x + pos.y * board.size());
+                cells.push_back(cell);
+                d_cell_constraints[cell].push_back(static_cast<u16>(i));
+            }
+        }
+    }
+
+    // Splits the open cells among the given ones into groups that share no house or
+    // constraint with each other
+    auto groups_of(const grid_state& state, std::span<const u16> cells) -> std::vector<std::vector<u16>>
+    {
+        ++d_walk;
+        auto groups = std::vector<std::vector<u16>>{};
+        auto pending = std::vector<u16>{};
+        const auto visit = [&](u16 cell) {
+            if (d_mark[cell] == d_walk || !is_open(state, cell)) return;
+            d_mark[cell] = d_walk;
+            pending.push_back(cell);
+        };
+
+        for (const auto start : cells) {
+            if (d_mark[start] == d_walk || !is_open(state, start)) continue;
+            auto& group = groups.emplace_back();
+            visit(start);
+            while (!pending.empty()) {
+                const auto cell = pending.back();
+                pending.pop_back();
+                group.push_back(cell);
+                for (const auto peer : d_board.peers(cell)) visit(peer);
+                for (const auto c : d_cell_constraints[cell]) {
+                    for (const auto other : d_constraint_cells[c]) visit(other);
+                }
+            }
+            std::ranges::sort(group);
+        }
+        return groups;
+    }
+
+    // The constraints reading any cell of the group
+    auto constraints_of(std::span<const u16> group) const -> std::vector<u16>
+    {
+        auto found = std::vector<u16>{};
+        for (const auto cell : group) {
+            found.insert(found.end(), d_cell_constraints[cell].begin(), d_cell_constraints[cell].end());
+        }
+        std::ranges::sort(found);
+        found.erase(std::ranges::unique(found).begin(), found.end());
+        return found;
+    }
+
+    auto all_solved(const grid_state& state, u16 constraint) const -> bool
+    {
+        return std::ranges::none_of(d_constraint_cells[constraint], [&](u16 cell) { return is_open(state, cell); });
+    }
+
+    // Checks the constraints that the step from before to after left with every cell solved
+    auto newly_solved_hold(const grid_state& before, const grid_state& after, std::span<const u16> constraints) const -> bool
+    {
+        auto board = std::optional<sudoku_board>{};
+        for (const auto c : constraints) {
+            if (all_solved(before, c) || !all_solved(after, c)) continue;
+            if (!board) {
+                auto values = solution(after.candidates.size(), 0);
+                for (std::size_t i = 0; i != values.size(); ++i) {
+                    if (std::has_single_bit(after.candidates[i])) values[i] = lowest_digit(after.candidates[i]);
+                }
+                board = d_board.with_values(values);
+            }
+            if (!d_board.constraints[c]->check(*board)) {
+                if (d_stats) d_stats->prunes.add(d_board.constraints[c]->name(), 1);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The count of a group depends only on the candidates of its cells and of the cells of
+    // the constraints reaching into it, everything else is either solved or in a group of
+    // its own
+    auto key_of(const grid_state& state, std::span<const u16> group, std::span<const u16> constraints) const -> hash128
+    {
+        auto key = hash128{};
+        for (const auto cell : group) {
+            key.add(cell);
+            key.add(state.candidates[cell]);
+        }
+        for (const auto c : constraints) {
+            key.add(u64_max - c);
+            for (const auto cell : d_constraint_cells[c]) key.add(state.candidates[cell]);
+        }
+        return key;
+    }
+
+    // The product of the counts of each group, stopping at the first with none
+    auto count_groups(const grid_state& state, const std::vector<std::vector<u16>>& groups) -> u64
+    {
+        if (groups.size() > 1 && d_stats) d_stats->technique_hits.add("component_split", 1);
+        auto total = u64{1};
+        for (const auto& group : groups) {
+            total = saturating_multiply(total, count_group(state, group));
+            if (total == 0) break;
+        }
+        return total;
+    }
+
+    auto count_group(const grid_state& state, std::span<const u16> group) -> u64
+    {
+        const auto constraints = constraints_of(group);
+        const auto key = key_of(state, group, constraints);
+        if (const auto it = d_cache.find(key); it != d_cache.end()) {
+            if (d_stats) d_stats->technique_hits.add("component_cache_hit", 1);
+            return it->second;
+        }
+        if (d_stats) ++d_stats->nodes;
+
+        // Branch on the cell of the group with the fewest candidates
+        const auto best = *std::ranges::min_element(group, {}, [&](u16 cell) { return std::popcount(state.candidates[cell]); });
+
+        auto total = u64{0};
+        auto queue = std::vector<u16>{};
+        for (auto mask = state.candidates[best]; mask;) {
+            const auto bit = lowest_bit(mask);
+            mask &= ~bit;
+
+            auto next = state;
+            next.candidates[best] = bit;
+            queue.assign(1, best);
+            if (!propagate_state(d_board, next, queue) || !newly_solved_hold(state, next, constraints)) {
+                if (d_stats) ++d_stats->backtracks;
+                continue;
+            }
+            total = saturating_add(total, count_groups(next, groups_of(next, group)));
+        }
+
+        if (d_cache.size() >= cache_capacity) d_cache.clear();
+        d_cache.emplace(key, total);
+        return total;
+    }
+
+    auto count(const grid_state& root) -> u64
+    {
+        auto cells = std::vector<u16>(root.candidates.size());
+        for (std::size_t i = 0; i != cells.size(); ++i) cells[i] = static_cast<u16>(i);
+
+        // Constraints solved by the givens alone are checked here, the rest as the groups
+        // they fall in solve them
+        auto all = std::vector<u16>(d_constraint_cells.size());
+        for (std::size_t i = 0; i != all.size(); ++i) all[i] = static_cast<u16>(i);
+        auto nothing = root;
+        std::ranges::fill(nothing.candidates, ~digit_mask{0});
+        if (!newly_solved_hold(nothing, root, all)) return 0;
+
+        return count_groups(root, groups_of(root, cells));
+    }
+};
+
+}
+
+auto count_by_components(const sudoku_board& board) -> u64
+{
+    const auto root = initial_state(board);
+    if (!root) return 0;
+
+    const auto timer = phase_timer{current_stats(), "search"};
+    return component_counter{board}.count(*root);
+}
+
+}
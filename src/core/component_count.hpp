@@ -0,0 +1,15 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+
+namespace sudoku {
+
+// Counts every solution without enumerating them one by one. Once propagated, unsolved
+// cells that share no house and no constraint can't affect each other, so each connected
+// group of them is counted on its own and the counts multiplied, splitting again as the
+// search inside a group solves more cells. Counts of groups whose candidates were seen
+// before are looked up rather than searched. The count saturates at u64_max, which reads
+// as "at least that many".
+auto count_by_components(const sudoku_board& board) -> u64;
+
+}
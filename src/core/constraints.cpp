@@ -4,9 +4,150 @@
 #include "renderer.hpp"
 #include "draw_board.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <set>
+#include <string>
 
 namespace sudoku {
+namespace {
+
+auto index_of(glm::ivec2 pos, u64 size) -> u64
+{
+    return static_cast<u64>(pos.x) + static_cast<u64>(pos.y) * size;
+}
+
+// Bits lo - 1 to hi - 1, the mask of the digits lo to hi, with lo at least 1
+auto digit_range(i64 lo, i64 hi) -> u64
+{
+    lo = std::max<i64>(lo, 1);
+    hi = std::min<i64>(hi, 64);
+    if (lo > hi) return 0;
+    const auto upto_hi = hi == 64 ? ~u64{0} : (u64{1} << hi) - 1;
+    return upto_hi & ~((u64{1} << (lo - 1)) - 1);
+}
+
+auto min_digit(u64 mask) -> i64 { return std::countr_zero(mask) + 1; }
+auto max_digit(u64 mask) -> i64 { return std::bit_width(mask); }
+
+// Applies the new mask, counting the candidates removed. False if none are left.
+auto narrow(u64& mask, u64 allowed, u64& removed) -> bool
+{
+    removed += std::popcount(mask & ~allowed);
+    mask &= allowed;
+    return mask != 0;
+}
+
+auto cell_centre(glm::ivec2 pos, const render_config& config) -> glm::vec2
+{
+    return config.tl + config.cell_size * glm::vec2{pos.x + 0.5f, pos.y + 0.5f};
+}
+
+// Writes an outside clue in the margin square at pos, which lies just off the grid
+auto draw_clue(renderer& r, const render_config& config, glm::ivec2 pos, i32 value) -> void
+{
+    const auto top_left = config.tl + config.cell_size * glm::vec2{pos.x, pos.y};
+    const auto size = static_cast<i32>(config.cell_size);
+    r.push_text_box(std::to_string(value), top_left, size, size, 3, from_hex(0x2d3436));
+}
+
+// Clue tables depend only on the board size, so each is built once per size and shared
+template <typename Table, typename Build>
+auto cached_table(u64 size, Build&& build) -> const Table&
+{
+    static auto mutex = std::mutex{};
+    static auto tables = std::map<u64, std::unique_ptr<const Table>>{};
+    const auto lock = std::scoped_lock{mutex};
+    auto& table = tables[size];
+    if (!table) table = std::make_unique<const Table>(build(size));
+    return *table;
+}
+
+// Enumerating subsets stops being cheap past this size, larger sandwiches are only checked
+constexpr u64 max_sandwich_table_size = 16;
+
+// Every set of the digits strictly between 1 and size as a mask, indexed by the set's sum
+// and then by how many digits it has
+using sandwich_table = std::vector<std::vector<std::vector<u64>>>;
+
+auto build_sandwich_table(u64 size) -> sandwich_table
+{
+    auto table = sandwich_table{};
+    if (size < 2 || size > max_sandwich_table_size) return table;
+
+    const auto middle = size - 2;
+    table.resize(middle * (middle + 3) / 2 + 1, std::vector<std::vector<u64>>(middle + 1));
+    for (u64 subset = 0; subset != u64{1} << middle; ++subset) {
+        const auto mask = subset << 1; // bit 0 is the digit 1, which is a crust
+        u64 sum = 0;
+        for (auto rest = mask; rest; rest &= rest - 1) sum += std::countr_zero(rest) + 1;
+        table[sum][std::popcount(mask)].push_back(mask);
+    }
+    return table;
+}
+
+// Permutations stop being cheap past this size, larger skyscrapers only use the bound that
+// the k-th cell from the clue is at most size - visible + k + 1
+constexpr u64 max_skyscraper_table_size = 9;
+
+// Indexed by the number of digits seen and then the position from the clue, the digits
+// some permutation of the line puts in that position
+using skyscraper_table = std::vector<std::vector<u64>>;
+
+auto build_skyscraper_table(u64 size) -> skyscraper_table
+{
+    auto table = skyscraper_table(size + 1, std::vector<u64>(size, 0));
+    if (size > max_skyscraper_table_size) {
+        for (u64 visible = 1; visible <= size; ++visible) {
+            for (u64 k = 0; k != size; ++k) {
+                table[visible][k] = digit_range(1, static_cast<i64>(size - visible + k + 1));
+            }
+            if (visible == 1) table[visible][0] = digit_range(size, size);
+        }
+        return table;
+    }
+
+    auto line = std::vector<i32>(size);
+    std::iota(line.begin(), line.end(), 1);
+    do {
+        u64 visible = 0;
+        i32 tallest = 0;
+        for (const auto digit : line) {
+            if (digit > tallest) {
+                tallest = digit;
+                ++visible;
+            }
+        }
+        for (u64 k = 0; k != size; ++k) table[visible][k] |= u64{1} << (line[k] - 1);
+    } while (std::next_permutation(line.begin(), line.end()));
+    return table;
+}
+
+// Indexed by the length of the diagonal and then the clue, the digits some filling puts in
+// a cell, 0 for clues no filling reaches. The table can't see boxes, so digits may repeat
+// and every position allows the same digits: those leaving a sum the other cells can make.
+using little_killer_table = std::vector<std::vector<u64>>;
+
+auto build_little_killer_table(u64 size) -> little_killer_table
+{
+    const auto largest = static_cast<i64>(size);
+    auto table = little_killer_table(size + 1);
+    for (u64 length = 1; length <= size; ++length) {
+        const auto others = static_cast<i64>(length - 1);
+        table[length].resize(length * size + 1, 0);
+        for (u64 sum = length; sum <= length * size; ++sum) {
+            const auto rest = static_cast<i64>(sum);
+            table[length][sum] = digit_range(std::max<i64>(rest - others * largest, 1), std::min(rest - others, largest));
+        }
+    }
+    return table;
+}
+
+}
 
 auto renban::check(const sudoku_board& board) const -> bool
 {
@@ -71,4 +212,307 @@ auto german_whisper::draw(renderer& r, const render_config& config) const -> voi
     }
 }
 
-}
\ No newline at end of file
+auto thermometer::check(const sudoku_board& board) const -> bool
+{
+    assert(d_positions.size() > 1);
+    for (std::size_t i = 0; i != d_positions.size() - 1; ++i) {
+        const auto& a = board.at(d_positions[i]);
+        const auto& b = board.at(d_positions[i + 1]);
+        if (!a.value || !b.value) return false;
+        if (*a.value >= *b.value) return false;
+    }
+    return true;
+}
+
+auto thermometer::draw(renderer& r, const render_config& config) const -> void
+{
+    assert(d_positions.size() > 1);
+    const auto colour = from_hex(0xb2bec3);
+    r.push_circle(cell_centre(d_positions.front(), config), colour, config.cell_size * 0.35f);
+    for (std::size_t i = 0; i != d_positions.size() - 1; ++i) {
+        const auto a = cell_centre(d_positions[i], config);
+        const auto b = cell_centre(d_positions[i + 1], config);
+        r.push_line(a, b, colour, config.cell_size * 0.25f);
+    }
+}
+
+// Each cell must beat the smallest digit before it and stay under the largest digit after
+// it, so one pass each way with the lowest and highest set bits bounds the whole thermo
+auto thermometer::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    u64 removed = 0;
+    for (std::size_t i = 1; i != d_positions.size(); ++i) {
+        const auto below = candidates[index_of(d_positions[i - 1], size)];
+        const auto above_lowest = ~((below & (~below + 1)) * 2 - 1);
+        if (!narrow(candidates[index_of(d_positions[i], size)], above_lowest, removed)) return {};
+    }
+    for (std::size_t i = d_positions.size() - 1; i != 0; --i) {
+        const auto above = candidates[index_of(d_positions[i], size)];
+        const auto below_highest = std::bit_floor(above) - 1;
+        if (!narrow(candidates[index_of(d_positions[i - 1], size)], below_highest, removed)) return {};
+    }
+    return removed;
+}
+
+auto arrow::cells() const -> std::vector<glm::ivec2>
+{
+    auto all = d_positions;
+    all.insert(all.begin(), d_circle);
+    return all;
+}
+
+auto arrow::check(const sudoku_board& board) const -> bool
+{
+    assert(!d_positions.empty());
+    const auto circle = board.at(d_circle).value;
+    if (!circle) return false;
+    i32 sum = 0;
+    for (const auto pos : d_positions) {
+        const auto value = board.at(pos).value;
+        if (!value) return false;
+        sum += *value;
+    }
+    return sum == *circle;
+}
+
+auto arrow::draw(renderer& r, const render_config& config) const -> void
+{
+    assert(!d_positions.empty());
+    const auto colour = from_hex(0x636e72);
+    const auto radius = config.cell_size * 0.4f;
+    const auto centre = cell_centre(d_circle, config);
+    r.push_annulus(centre, colour, radius - 2.0f, radius);
+
+    // The shaft starts at the edge of the circle and ends in a head on the last cell
+    const auto first = cell_centre(d_positions.front(), config);
+    r.push_line(centre + glm::normalize(first - centre) * radius, first, colour, 3.0f);
+    for (std::size_t i = 0; i != d_positions.size() - 1; ++i) {
+        r.push_line(cell_centre(d_positions[i], config), cell_centre(d_positions[i + 1], config), colour, 3.0f);
+    }
+    const auto tip = cell_centre(d_positions.back(), config);
+    const auto from = d_positions.size() > 1 ? cell_centre(d_positions[d_positions.size() - 2], config) : centre;
+    const auto back = glm::normalize(from - tip) * (config.cell_size * 0.2f);
+    const auto side = glm::vec2{-back.y, back.x};
+    r.push_line(tip, tip + back + side, colour, 3.0f);
+    r.push_line(tip, tip + back - side, colour, 3.0f);
+}
+
+// The sum of the arrow lies between the sums of its cells' lowest and highest candidates,
+// which bounds the circle, and the circle's bounds less the rest of the arrow bound each cell
+auto arrow::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    u64 removed = 0;
+    i64 min_sum = 0;
+    i64 max_sum = 0;
+    for (const auto pos : d_positions) {
+        const auto mask = candidates[index_of(pos, size)];
+        min_sum += min_digit(mask);
+        max_sum += max_digit(mask);
+    }
+
+    auto& circle = candidates[index_of(d_circle, size)];
+    if (!narrow(circle, digit_range(min_sum, max_sum), removed)) return {};
+
+    const auto circle_min = min_digit(circle);
+    const auto circle_max = max_digit(circle);
+    for (const auto pos : d_positions) {
+        auto& mask = candidates[index_of(pos, size)];
+        const auto others_min = min_sum - min_digit(mask);
+        const auto others_max = max_sum - max_digit(mask);
+        if (!narrow(mask, digit_range(circle_min - others_max, circle_max - others_min), removed)) return {};
+    }
+    return removed;
+}
+
+auto line_from(grid_side side, i32 index, u64 size) -> std::vector<glm::ivec2>
+{
+    const auto n = static_cast<i32>(size);
+    auto line = std::vector<glm::ivec2>{};
+    for (i32 k = 0; k != n; ++k) {
+        switch (side) {
+            case grid_side::top:    line.push_back({index, k}); break;
+            case grid_side::bottom: line.push_back({index, n - 1 - k}); break;
+            case grid_side::left:   line.push_back({k, index}); break;
+            case grid_side::right:  line.push_back({n - 1 - k, index}); break;
+        }
+    }
+    return line;
+}
+
+sandwich::sandwich(grid_side side, i32 index, i32 sum, u64 size)
+    : d_sum{sum}
+    , d_line{line_from(side, index, size)}
+{
+    const auto& table = cached_table<sandwich_table>(size, build_sandwich_table);
+    if (0 <= sum && static_cast<u64>(sum) < table.size()) d_fillings = table[sum];
+}
+
+auto sandwich::check(const sudoku_board& board) const -> bool
+{
+    const auto largest = static_cast<i32>(board.digits());
+    auto inside = false;
+    i32 sum = 0;
+    for (const auto pos : d_line) {
+        const auto value = board.at(pos).value;
+        if (!value) return false;
+        if (*value == 1 || *value == largest) {
+            if (inside) return sum == d_sum;
+            inside = true;
+        } else if (inside) {
+            sum += *value;
+        }
+    }
+    return false;
+}
+
+auto sandwich::draw(renderer& r, const render_config& config) const -> void
+{
+    draw_clue(r, config, d_line[0] * 2 - d_line[1], d_sum);
+}
+
+// Tries every pair of cells for the crusts and every set of digits with the right sum and
+// size for the gap between them. A cell keeps the digits some consistent choice gives it.
+auto sandwich::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    if (d_fillings.empty()) return 0;
+
+    const auto n = d_line.size();
+    auto masks = std::array<u64, max_sandwich_table_size>{};
+    for (std::size_t k = 0; k != n; ++k) masks[k] = candidates[index_of(d_line[k], size)];
+
+    const auto low = u64{1};
+    const auto high = u64{1} << (size - 1);
+    auto allowed = std::array<u64, max_sandwich_table_size>{};
+    for (std::size_t i = 0; i != n; ++i) {
+        for (std::size_t j = i + 1; j != n; ++j) {
+            const auto gap = j - i - 1;
+            if (gap >= d_fillings.size()) break;
+            for (const auto& [first, last] : {std::pair{low, high}, std::pair{high, low}}) {
+                if (!(masks[i] & first) || !(masks[j] & last)) continue;
+                for (const auto filling : d_fillings[gap]) {
+                    const auto outer = ~(filling | low | high);
+                    auto fits = true;
+                    for (std::size_t k = 0; k != n && fits; ++k) {
+                        if (k == i || k == j) continue;
+                        fits = (masks[k] & (i < k && k < j ? filling : outer)) != 0;
+                    }
+                    if (!fits) continue;
+                    allowed[i] |= first;
+                    allowed[j] |= last;
+                    for (std::size_t k = 0; k != n; ++k) {
+                        if (k == i || k == j) continue;
+                        allowed[k] |= masks[k] & (i < k && k < j ? filling : outer);
+                    }
+                }
+            }
+        }
+    }
+
+    u64 removed = 0;
+    for (std::size_t k = 0; k != n; ++k) {
+        if (!narrow(candidates[index_of(d_line[k], size)], allowed[k], removed)) return {};
+    }
+    return removed;
+}
+
+skyscraper::skyscraper(grid_side side, i32 index, i32 visible, u64 size)
+    : d_visible{visible}
+    , d_line{line_from(side, index, size)}
+{
+    const auto& table = cached_table<skyscraper_table>(size, build_skyscraper_table);
+    if (1 <= visible && static_cast<u64>(visible) < table.size()) d_allowed = table[visible];
+    else d_allowed.assign(size, 0); // no arrangement sees that many
+}
+
+auto skyscraper::check(const sudoku_board& board) const -> bool
+{
+    i32 seen = 0;
+    i32 tallest = 0;
+    for (const auto pos : d_line) {
+        const auto value = board.at(pos).value;
+        if (!value) return false;
+        if (*value > tallest) {
+            tallest = *value;
+            ++seen;
+        }
+    }
+    return seen == d_visible;
+}
+
+auto skyscraper::draw(renderer& r, const render_config& config) const -> void
+{
+    draw_clue(r, config, d_line[0] * 2 - d_line[1], d_visible);
+}
+
+auto skyscraper::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    u64 removed = 0;
+    for (std::size_t k = 0; k != d_line.size(); ++k) {
+        if (!narrow(candidates[index_of(d_line[k], size)], d_allowed[k], removed)) return {};
+    }
+    return removed;
+}
+
+little_killer::little_killer(glm::ivec2 first, glm::ivec2 step, i32 sum, u64 size)
+    : d_first{first}
+    , d_step{step}
+    , d_sum{sum}
+{
+    const auto n = static_cast<i32>(size);
+    for (auto pos = first; 0 <= pos.x && pos.x < n && 0 <= pos.y && pos.y < n; pos += step) {
+        d_diagonal.push_back(pos);
+    }
+
+    const auto& table = cached_table<little_killer_table>(size, build_little_killer_table);
+    const auto length = d_diagonal.size();
+    if (length < table.size() && 0 <= sum && static_cast<u64>(sum) < table[length].size()) d_allowed = table[length][sum];
+}
+
+auto little_killer::check(const sudoku_board& board) const -> bool
+{
+    i32 sum = 0;
+    for (const auto pos : d_diagonal) {
+        const auto value = board.at(pos).value;
+        if (!value) return false;
+        sum += *value;
+    }
+    return sum == d_sum;
+}
+
+auto little_killer::draw(renderer& r, const render_config& config) const -> void
+{
+    const auto clue = d_first - d_step;
+    draw_clue(r, config, clue, d_sum);
+
+    // A short stroke from the clue's corner towards the diagonal
+    const auto colour = from_hex(0x2d3436);
+    const auto corner = cell_centre(clue, config) + glm::vec2{d_step.x, d_step.y} * (config.cell_size * 0.35f);
+    r.push_line(corner, corner + glm::vec2{d_step.x, d_step.y} * (config.cell_size * 0.25f), colour, 2.0f);
+}
+
+// Cells first keep the digits the clue table allows, then each is narrowed to the digits
+// that leave the sum between the smallest and largest the other cells can make. Neither
+// step is exact: the bounds skip over gaps in the other cells' candidates, and cells that
+// share a box can't repeat a digit.
+auto little_killer::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    u64 removed = 0;
+    i64 min_sum = 0;
+    i64 max_sum = 0;
+    for (const auto pos : d_diagonal) {
+        auto& mask = candidates[index_of(pos, size)];
+        if (!narrow(mask, d_allowed, removed)) return {};
+        min_sum += min_digit(mask);
+        max_sum += max_digit(mask);
+    }
+
+    for (const auto pos : d_diagonal) {
+        auto& mask = candidates[index_of(pos, size)];
+        const auto others_min = min_sum - min_digit(mask);
+        const auto others_max = max_sum - max_digit(mask);
+        if (!narrow(mask, digit_range(d_sum - others_max, d_sum - others_min), removed)) return {};
+    }
+    return removed;
+}
+
+}
@@ -1,5 +1,11 @@
 #pragma once
+#include "common.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
 #include <vector>
+#include <string_view>
 #include <glm/glm.hpp>
 
 namespace sudoku {
@@ -13,6 +19,24 @@ class constraint
 public:
     virtual auto check(const sudoku_board& board) const -> bool = 0;
     virtual auto draw(renderer& r, const render_config& config) const -> void = 0;
+    virtual auto name() const -> std::string_view = 0; // used to key solver stats
+
+    // The cells the constraint reads, check and propagate look at no others
+    virtual auto cells() const -> std::vector<glm::ivec2> = 0;
+
+    // Whatever tells the constraint apart from another of its kind on the same cells, such
+    // as a sum, written out so puzzles can be compared and hashed
+    virtual auto clue() const -> std::string { return {}; }
+
+    // Narrows the solver's candidate masks (bit d - 1 for digit d, indexed x + y * size) to
+    // the digits the constraint still allows. Returns the number of candidates removed, or
+    // nothing if a cell ran out. Constraints without propagation are only checked once the
+    // grid is full.
+    virtual auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> { return 0; }
+
+    // True if the clue is drawn in the margin just off the grid
+    virtual auto outside_clue() const -> bool { return false; }
+
     virtual ~constraint() = default;
 };
 
@@ -24,6 +48,8 @@ public:
     renban(const std::vector<glm::ivec2>& positions) : d_positions{positions} {}
     auto check(const sudoku_board& board) const -> bool override;
     auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "renban"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_positions; }
 };
 
 class german_whisper : public constraint
@@ -34,6 +60,107 @@ public:
     german_whisper(const std::vector<glm::ivec2>& positions) : d_positions{positions} {}
     auto check(const sudoku_board& board) const -> bool override;
     auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "german_whisper"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_positions; }
+};
+
+// Digits strictly increase from the bulb, the first position, to the tip
+class thermometer : public constraint
+{
+    std::vector<glm::ivec2> d_positions;
+
+public:
+    thermometer(const std::vector<glm::ivec2>& positions) : d_positions{positions} {}
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "thermometer"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_positions; }
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+};
+
+// The digit in the circle is the sum of the digits along the arrow
+class arrow : public constraint
+{
+    glm::ivec2              d_circle;
+    std::vector<glm::ivec2> d_positions;
+
+public:
+    arrow(glm::ivec2 circle, const std::vector<glm::ivec2>& positions) : d_circle{circle}, d_positions{positions} {}
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "arrow"; }
+    auto cells() const -> std::vector<glm::ivec2> override;
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+};
+
+// Outside clues sit in the margin and read along the row or column from that side
+enum class grid_side : u8
+{
+    top,
+    bottom,
+    left,
+    right,
+};
+
+// The cells of a row or column in order from the given side inwards
+auto line_from(grid_side side, i32 index, u64 size) -> std::vector<glm::ivec2>;
+
+// The digits between the 1 and the largest digit of the row or column sum to the clue
+class sandwich : public constraint
+{
+    i32                               d_sum;
+    std::vector<glm::ivec2>           d_line;
+    std::span<const std::vector<u64>> d_fillings; // by gap size, the digit sets summing to d_sum
+
+public:
+    sandwich(grid_side side, i32 index, i32 sum, u64 size);
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "sandwich"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_line; }
+    auto clue() const -> std::string override { return std::to_string(d_sum); }
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+    auto outside_clue() const -> bool override { return true; }
+};
+
+// Counting from the clue, a digit is seen if it is larger than every digit before it, and
+// the clue is the number of digits seen
+class skyscraper : public constraint
+{
+    i32                     d_visible;
+    std::vector<glm::ivec2> d_line;
+    std::vector<u64>        d_allowed; // per cell along the line, the digits some arrangement puts there
+
+public:
+    skyscraper(grid_side side, i32 index, i32 visible, u64 size);
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "skyscraper"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_line; }
+    auto clue() const -> std::string override { return std::to_string(d_visible); }
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+    auto outside_clue() const -> bool override { return true; }
+};
+
+// The digits on the diagonal starting at first and moving by step sum to the clue, which
+// sits just outside the grid before first. Digits may repeat unless they share a house.
+class little_killer : public constraint
+{
+    glm::ivec2              d_first;
+    glm::ivec2              d_step;
+    i32                     d_sum;
+    std::vector<glm::ivec2> d_diagonal;
+    u64                     d_allowed = 0; // the digits the clue table allows in any cell
+
+public:
+    little_killer(glm::ivec2 first, glm::ivec2 step, i32 sum, u64 size);
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "little_killer"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_diagonal; }
+    auto clue() const -> std::string override { return std::to_string(d_sum); }
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+    auto outside_clue() const -> bool override { return true; }
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,457 @@
+#include "custom_rule.hpp"
+#include "utility.hpp"
+#include "sudoku.hpp"
+#include "renderer.hpp"
+#include "draw_board.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cctype>
+#include <format>
+#include <print>
+
+namespace sudoku {
+namespace {
+
+// Limits that let the interpreter keep everything in fixed arrays, so it never allocates
+constexpr u64 max_stack = 16;
+constexpr u64 max_slots = 64;
+
+// One lane per digit a cell can hold. Every instruction is a fixed-length loop over the
+// lanes, which the compiler turns into vector code.
+constexpr u64 rule_lanes = 64;
+constexpr u64 no_focus = u64_max;
+
+constexpr u64 even_digits = 0xaaaaaaaaaaaaaaaa; // bit d - 1 for digit d
+constexpr u64 odd_digits = 0x5555555555555555;
+
+auto index_of(glm::ivec2 pos, u64 size) -> u64
+{
+    return static_cast<u64>(pos.x) + static_cast<u64>(pos.y) * size;
+}
+
+auto narrow(u64& mask, u64 allowed, u64& removed) -> bool
+{
+    removed += std::popcount(mask & ~allowed);
+    mask &= allowed;
+    return mask != 0;
+}
+
+struct lane_range
+{
+    std::array<i32, rule_lanes> lo;
+    std::array<i32, rule_lanes> hi;
+};
+
+struct lane_truth
+{
+    u64 certain = 0;
+    u64 possible = 0;
+};
+
+// Runs the code with each cell's candidates standing for the range from its lowest to its
+// highest, except for the cell in the focus slot, which lane d holds at the digit d + 1.
+// Returns, per lane, whether the rule certainly and possibly holds.
+auto run(std::span<const rule_instruction> code, std::span<const u64> sets, std::span<const u64> masks, u64 focus) -> lane_truth
+{
+    std::array<lane_range, max_stack> stack; // left uninitialised, only pushed entries are read
+    u64 top = 0;
+
+    const auto binary = [&](auto&& f) {
+        auto& a = stack[top - 2];
+        const auto& b = stack[top - 1];
+        for (u64 i = 0; i != rule_lanes; ++i) f(a.lo[i], a.hi[i], b.lo[i], b.hi[i]);
+        --top;
+    };
+    const auto unary = [&](auto&& f) {
+        auto& a = stack[top - 1];
+        for (u64 i = 0; i != rule_lanes; ++i) f(a.lo[i], a.hi[i]);
+    };
+    const auto push = [&](i32 lo, i32 hi) {
+        auto& a = stack[top++];
+        a.lo.fill(lo);
+        a.hi.fill(hi);
+    };
+
+    for (const auto& in : code) {
+        switch (in.op) {
+            case rule_op::push_number: {
+                push(in.value, in.value);
+            } break;
+            case rule_op::push_cell: {
+                if (in.slot == focus) {
+                    auto& a = stack[top++];
+                    for (u64 i = 0; i != rule_lanes; ++i) a.lo[i] = a.hi[i] = static_cast<i32>(i) + 1;
+                } else {
+                    const auto mask = masks[in.slot];
+                    push(std::countr_zero(mask) + 1, std::bit_width(mask));
+                }
+            } break;
+            case rule_op::member: {
+                const auto set = sets[in.value];
+                if (in.slot == focus) {
+                    auto& a = stack[top++];
+                    for (u64 i = 0; i != rule_lanes; ++i) a.lo[i] = a.hi[i] = static_cast<i32>((set >> i) & 1);
+                } else {
+                    const auto mask = masks[in.slot];
+                    push((mask & ~set) == 0, (mask & set) != 0);
+                }
+            } break;
+            case rule_op::add: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { lo += blo; hi += bhi; });
+            } break;
+            case rule_op::subtract: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { const auto l = lo - bhi; hi -= blo; lo = l; });
+            } break;
+            case rule_op::negate: {
+                unary([](i32& lo, i32& hi) { const auto l = -hi; hi = -lo; lo = l; });
+            } break;
+            case rule_op::absolute: {
+                unary([](i32& lo, i32& hi) {
+                    const auto l = lo >= 0 ? lo : hi <= 0 ? -hi : 0;
+                    hi = std::max(-lo, hi);
+                    lo = l;
+                });
+            } break;
+            case rule_op::equal: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) {
+                    const auto certain = lo == hi && blo == bhi && lo == blo;
+                    const auto possible = lo <= bhi && blo <= hi;
+                    lo = certain;
+                    hi = possible;
+                });
+            } break;
+            case rule_op::not_equal: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) {
+                    const auto certain = hi < blo || bhi < lo;
+                    const auto possible = !(lo == hi && blo == bhi && lo == blo);
+                    lo = certain;
+                    hi = possible;
+                });
+            } break;
+            case rule_op::less: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { const auto c = hi < blo; hi = lo < bhi; lo = c; });
+            } break;
+            case rule_op::less_equal: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { const auto c = hi <= blo; hi = lo <= bhi; lo = c; });
+            } break;
+            case rule_op::greater: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { const auto c = lo > bhi; hi = hi > blo; lo = c; });
+            } break;
+            case rule_op::greater_equal: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { const auto c = lo >= bhi; hi = hi >= blo; lo = c; });
+            } break;
+            case rule_op::both: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { lo = std::min(lo, blo); hi = std::min(hi, bhi); });
+            } break;
+            case rule_op::either: {
+                binary([](i32& lo, i32& hi, i32 blo, i32 bhi) { lo = std::max(lo, blo); hi = std::max(hi, bhi); });
+            } break;
+        }
+    }
+
+    assert(top == 1);
+    auto truth = lane_truth{};
+    for (u64 i = 0; i != rule_lanes; ++i) {
+        truth.certain |= static_cast<u64>(stack[0].lo[i] != 0) << i;
+        truth.possible |= static_cast<u64>(stack[0].hi[i] != 0) << i;
+    }
+    return truth;
+}
+
+// Recursive descent over the source, emitting the code in postfix order as it goes
+class rule_compiler
+{
+    std::string_view              d_source;
+    std::size_t                   d_pos = 0;
+    u64                           d_size;
+    u64                           d_depth = 0;
+    u64                           d_max_depth = 0;
+    std::string                   d_error;
+    std::vector<rule_instruction> d_code;
+    std::vector<glm::ivec2>       d_cells;
+    std::vector<u64>              d_sets;
+
+    auto fail(std::string_view message) -> bool
+    {
+        if (d_error.empty()) d_error = std::format("{} at column {}", message, d_pos + 1);
+        return false;
+    }
+
+    auto skip_spaces() -> void
+    {
+        while (d_pos < d_source.size() && std::isspace(static_cast<unsigned char>(d_source[d_pos]))) ++d_pos;
+    }
+
+    auto accept(std::string_view symbol) -> bool
+    {
+        skip_spaces();
+        if (!d_source.substr(d_pos).starts_with(symbol)) return false;
+        d_pos += symbol.size();
+        return true;
+    }
+
+    auto expect(std::string_view symbol) -> bool
+    {
+        return accept(symbol) || fail(std::format("expected '{}'", symbol));
+    }
+
+    // The letters and digits starting here, without consuming them
+    auto peek_word() -> std::string_view
+    {
+        skip_spaces();
+        auto end = d_pos;
+        while (end < d_source.size() && std::isalnum(static_cast<unsigned char>(d_source[end]))) ++end;
+        return d_source.substr(d_pos, end - d_pos);
+    }
+
+    auto accept_word(std::string_view word) -> bool
+    {
+        if (peek_word() != word) return false;
+        d_pos += word.size();
+        return true;
+    }
+
+    auto parse_number(i32& value) -> bool
+    {
+        skip_spaces();
+        const auto start = d_pos;
+        value = 0;
+        while (d_pos < d_source.size() && std::isdigit(static_cast<unsigned char>(d_source[d_pos])) && value < 1'000'000) {
+            value = value * 10 + (d_source[d_pos++] - '0');
+        }
+        return d_pos != start || fail("expected a number");
+    }
+
+    auto emit(rule_op op, u16 slot = 0, i32 value = 0) -> void
+    {
+        switch (op) {
+            case rule_op::push_number:
+            case rule_op::push_cell:
+            case rule_op::member:
+                d_max_depth = std::max(d_max_depth, ++d_depth);
+                break;
+            case rule_op::negate:
+            case rule_op::absolute:
+                break;
+            default:
+                --d_depth;
+                break;
+        }
+        d_code.push_back({op, slot, value});
+    }
+
+    auto parse_cell(u16& slot) -> bool
+    {
+        skip_spaces();
+        auto row = 0;
+        auto column = 0;
+        if (!accept("r") || !parse_number(row) || !accept("c") || !parse_number(column)) return fail("expected a cell such as r1c1");
+        if (row < 1 || column < 1 || static_cast<u64>(row) > d_size || static_cast<u64>(column) > d_size) return fail("cell is off the board");
+
+        const auto pos = glm::ivec2{column - 1, row - 1};
+        const auto it = std::ranges::find(d_cells, pos);
+        if (it == d_cells.end() && d_cells.size() == max_slots) return fail("too many cells");
+        slot = static_cast<u16>(it - d_cells.begin());
+        if (it == d_cells.end()) d_cells.push_back(pos);
+        return true;
+    }
+
+    // Every cell of the list must hold a digit of the set
+    auto parse_membership(u64 set) -> bool
+    {
+        auto slots = std::vector<u16>{};
+        do {
+            if (!parse_cell(slots.emplace_back())) return false;
+        } while (accept(","));
+
+        if (set == 0) {
+            if (!expect(";")) return false;
+            do {
+                auto digit = 0;
+                if (!parse_number(digit)) return false;
+                if (digit < 1 || static_cast<u64>(digit) > d_size) return fail("digit is out of range");
+                set |= u64{1} << (digit - 1);
+            } while (accept(","));
+        }
+        if (!expect(")")) return false;
+
+        d_sets.push_back(set);
+        for (std::size_t i = 0; i != slots.size(); ++i) {
+            emit(rule_op::member, slots[i], static_cast<i32>(d_sets.size() - 1));
+            if (i != 0) emit(rule_op::both);
+        }
+        return true;
+    }
+
+    auto parse_term() -> bool
+    {
+        auto value = 0;
+        auto slot = u16{0};
+        if (accept("-")) {
+            if (!parse_term()) return false;
+            emit(rule_op::negate);
+            return true;
+        }
+        if (accept("(")) return parse_expression() && expect(")");
+        if (accept_word("abs")) {
+            if (!expect("(") || !parse_expression() || !expect(")")) return false;
+            emit(rule_op::absolute);
+            return true;
+        }
+        if (accept_word("sum")) {
+            if (!expect("(")) return false;
+            auto first = true;
+            do {
+                if (!parse_cell(slot)) return false;
+                emit(rule_op::push_cell, slot);
+                if (!first) emit(rule_op::add);
+                first = false;
+            } while (accept(","));
+            return expect(")");
+        }
+        if (peek_word().starts_with('r')) {
+            if (!parse_cell(slot)) return false;
+            emit(rule_op::push_cell, slot);
+            return true;
+        }
+        if (!parse_number(value)) return false;
+        emit(rule_op::push_number, 0, value);
+        return true;
+    }
+
+    auto parse_expression() -> bool
+    {
+        if (!parse_term()) return false;
+        while (true) {
+            if (accept("+")) {
+                if (!parse_term()) return false;
+                emit(rule_op::add);
+            } else if (accept("-")) {
+                if (!parse_term()) return false;
+                emit(rule_op::subtract);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    auto parse_condition() -> bool
+    {
+        if (accept_word("even")) return expect("(") && parse_membership(even_digits);
+        if (accept_word("odd")) return expect("(") && parse_membership(odd_digits);
+        if (accept_word("in")) return expect("(") && parse_membership(0);
+
+        if (!parse_expression()) return false;
+        static constexpr auto comparisons = std::array{
+            std::pair{std::string_view{"<="}, rule_op::less_equal},
+            std::pair{std::string_view{">="}, rule_op::greater_equal},
+            std::pair{std::string_view{"!="}, rule_op::not_equal},
+            std::pair{std::string_view{"<"}, rule_op::less},
+            std::pair{std::string_view{">"}, rule_op::greater},
+            std::pair{std::string_view{"="}, rule_op::equal},
+        };
+        for (const auto& [symbol, op] : comparisons) {
+            if (!accept(symbol)) continue;
+            if (!parse_expression()) return false;
+            emit(op);
+            return true;
+        }
+        return fail("expected a comparison");
+    }
+
+    auto parse_conjunction() -> bool
+    {
+        if (!parse_condition()) return false;
+        while (accept_word("and")) {
+            if (!parse_condition()) return false;
+            emit(rule_op::both);
+        }
+        return true;
+    }
+
+    auto parse_rule() -> bool
+    {
+        if (!parse_conjunction()) return false;
+        while (accept_word("or")) {
+            if (!parse_conjunction()) return false;
+            emit(rule_op::either);
+        }
+        skip_spaces();
+        if (d_pos != d_source.size()) return fail("unexpected text");
+        if (d_max_depth > max_stack) return fail("rule is nested too deeply");
+        return true;
+    }
+
+public:
+    rule_compiler(std::string_view source, u64 size) : d_source{source}, d_size{size} {}
+
+    // True if the whole source parsed, otherwise error() says where it went wrong
+    auto compile() -> bool { return parse_rule(); }
+    auto error() const -> const std::string& { return d_error; }
+
+    auto code() -> std::vector<rule_instruction>& { return d_code; }
+    auto cells() -> std::vector<glm::ivec2>& { return d_cells; }
+    auto sets() -> std::vector<u64>& { return d_sets; }
+};
+
+}
+
+auto custom_rule::compile(std::string_view source, u64 size) -> std::optional<custom_rule>
+{
+    auto compiler = rule_compiler{source, size};
+    if (!compiler.compile()) {
+        std::print("custom_rule failed - {} in '{}'\n", compiler.error(), source);
+        return {};
+    }
+
+    auto rule = custom_rule{};
+    rule.d_source = std::string{source};
+    rule.d_code = std::move(compiler.code());
+    rule.d_cells = std::move(compiler.cells());
+    rule.d_sets = std::move(compiler.sets());
+    return rule;
+}
+
+auto custom_rule::check(const sudoku_board& board) const -> bool
+{
+    auto masks = std::array<u64, max_slots>{};
+    for (std::size_t slot = 0; slot != d_cells.size(); ++slot) {
+        const auto value = board.at(d_cells[slot]).value;
+        if (!value) return false;
+        masks[slot] = u64{1} << (*value - 1);
+    }
+    return run(d_code, d_sets, masks, no_focus).certain & 1;
+}
+
+auto custom_rule::draw(renderer& r, const render_config& config) const -> void
+{
+    const auto colour = from_hex(0xfdcb6e);
+    for (const auto pos : d_cells) {
+        const auto corner = config.tl + config.cell_size * glm::vec2{pos.x + 0.15f, pos.y + 0.15f};
+        r.push_circle(corner, colour, config.cell_size * 0.07f);
+    }
+}
+
+// Each cell in turn runs the code with one lane per digit, and keeps the digits whose lane
+// says the rule can still hold
+auto custom_rule::propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64>
+{
+    auto masks = std::array<u64, max_slots>{};
+    for (std::size_t slot = 0; slot != d_cells.size(); ++slot) {
+        masks[slot] = candidates[index_of(d_cells[slot], size)];
+    }
+
+    u64 removed = 0;
+    for (std::size_t slot = 0; slot != d_cells.size(); ++slot) {
+        const auto truth = run(d_code, d_sets, masks, slot);
+        auto& mask = candidates[index_of(d_cells[slot], size)];
+        if (!narrow(mask, truth.possible, removed)) return {};
+        masks[slot] = mask;
+    }
+    return removed;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "common.hpp"
+#include "constraints.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sudoku {
+
+// The instructions of a compiled rule. They run on a stack where every entry is a range of
+// digits, and truths are the range [certain, possible] with 0 for false and 1 for true.
+enum class rule_op : u8
+{
+    push_number,   // value
+    push_cell,     // the lowest to the highest candidate of the cell in slot
+    add,
+    subtract,
+    negate,
+    absolute,
+    equal,
+    not_equal,
+    less,
+    less_equal,
+    greater,
+    greater_equal,
+    member,        // whether the cell in slot holds a digit of the set with index value
+    both,
+    either,
+};
+
+struct rule_instruction
+{
+    rule_op op;
+    u16     slot  = 0;
+    i32     value = 0;
+};
+
+// A constraint written as text and compiled to bytecode when the puzzle is loaded, so new
+// rules need no rebuild. Cells are written r<row>c<column>, counting from 1. A rule is a
+// number of conditions joined by 'and' and 'or', with 'and' binding tighter:
+//
+//     sum(r1c1, r1c2, r1c3) = 15          the digits add up to 15
+//     abs(r4c4 - r4c5) >= 5               the digits are at least 5 apart
+//     even(r2c2, r2c3)                    every digit is even, and odd(...) odd
+//     in(r9c1, r9c2; 1, 3, 5)             every digit is one of those listed
+//     r1c1 + r2c2 = r3c3 or r1c1 < 3
+//
+// Sums and differences are bounded by ranges of candidates, so propagation removes a digit
+// only if no choice in the other cells' ranges could satisfy the rule with it.
+class custom_rule : public constraint
+{
+    std::string                   d_source;
+    std::vector<rule_instruction> d_code;
+    std::vector<glm::ivec2>       d_cells; // by slot
+    std::vector<u64>              d_sets;  // digit masks used by member
+
+public:
+    // Compiles the source for a board of the given width, or prints the problem and returns
+    // nothing if it doesn't parse
+    static auto compile(std::string_view source, u64 size) -> std::optional<custom_rule>;
+
+    auto check(const sudoku_board& board) const -> bool override;
+    auto draw(renderer& r, const render_config& config) const -> void override;
+    auto name() const -> std::string_view override { return "custom_rule"; }
+    auto cells() const -> std::vector<glm::ivec2> override { return d_cells; }
+    auto clue() const -> std::string override { return d_source; }
+    auto propagate(std::span<u64> candidates, u64 size) const -> std::optional<u64> override;
+
+    auto source() const -> const std::string& { return d_source; }
+};
+
+}
@@ -1,5 +1,7 @@
 #include "draw_board.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <ranges>
 
 namespace sudoku {
@@ -11,18 +13,42 @@ constexpr auto colour_added_digits = from_hex(0x1abc9c);
 constexpr auto colour_cell = from_hex(0x2c3e50);
 constexpr auto colour_cell_hightlighted = from_hex(0x34495e);
 
-// draw backboard
+// draw backboard, one square per grid so the gaps of a multi-grid board stay empty
 auto draw_backboard(renderer& r, const sudoku_board& board, const render_config& config)
 {
-    r.push_rect(config.tl, config.board_size, config.board_size, colour_cell);
+    const auto extent = board.digits() * config.cell_size;
+    for (const auto grid : board.grids()) {
+        const auto tl = config.tl + config.cell_size * glm::vec2{grid.x, grid.y};
+        r.push_rect(tl, extent, extent, colour_cell);
+
+        for (i32 i = 1; i != board.digits(); ++i) {
+            const auto offset = glm::vec2{0, i * config.cell_size};
+            r.push_line(tl + offset, tl + offset + glm::vec2{extent, 0}, from_hex(0x34495e), 1.f);
+        }
+        for (i32 i = 1; i != board.digits(); ++i) {
+            const auto offset = glm::vec2{i * config.cell_size, 0};
+            r.push_line(tl + offset, tl + offset + glm::vec2{0, extent}, from_hex(0x34495e), 1.f);
+        }
+    }
+}
 
-    for (i32 i = 1; i != board.size(); ++i) {
-        const auto offset = glm::vec2{0, i * config.cell_size};
-        r.push_line(config.tl + offset, config.tr + offset, from_hex(0x34495e), 1.f);
+// draw the geometry rules that can be seen, the diagonals and the windoku windows
+auto draw_geometry(renderer& r, const sudoku_board& board, const render_config& config)
+{
+    const auto colour = from_hex(0x3d566e);
+    if (board.geometry() & windoku) {
+        const auto n = static_cast<i32>(board.size());
+        const auto box = static_cast<i32>(std::lround(std::sqrt(static_cast<f32>(n))));
+        for (i32 top = 1; top + box < n; top += box + 1) {
+            for (i32 left = 1; left + box < n; left += box + 1) {
+                const auto window_tl = config.tl + config.cell_size * glm::vec2{left, top};
+                r.push_rect(window_tl, box * config.cell_size, box * config.cell_size, colour);
+            }
+        }
     }
-    for (i32 i = 1; i != board.size(); ++i) {
-        const auto offset = glm::vec2{i * config.cell_size, 0};
-        r.push_line(config.tl + offset, config.bl + offset, from_hex(0x34495e), 1.f);
+    if (board.geometry() & diagonal) {
+        r.push_line(config.tl, config.br, colour, 3.f);
+        r.push_line(config.tr, config.bl, colour, 3.f);
     }
 }
 
@@ -44,17 +70,13 @@ auto draw_constraints(renderer& r, const sudoku_board& board, const board_render
 {
     // should this be elsewhere? probably...
     if (auto inner = std::get_if<empty_cells_rs>(&state)) {
-        for (int y = 0; y != board.size(); ++y) {
-            for (int x = 0; x != board.size(); ++x) {
-                
-                if (inner->cells.contains(glm::ivec2{x, y})) {
-                    const auto t = std::chrono::duration<double>(config.now - inner->time).count();
-                    auto cell_colour = from_hex(0xc0392b, 1 - t);
-                    const auto cell_centre = config.tl + config.cell_size * glm::vec2{x + 0.5f, y + 0.5f};
-                    r.push_quad(cell_centre, config.cell_size, config.cell_size, 0, cell_colour);
-                }
-            }
-        }
+        const auto t = std::chrono::duration<double>(config.now - inner->time).count();
+        const auto cell_colour = from_hex(0xc0392b, 1 - t);
+        inner->cells.for_each([&](u64 cell) {
+            const auto pos = board.position_of(cell_index{cell});
+            const auto cell_centre = config.tl + config.cell_size * glm::vec2{pos.x + 0.5f, pos.y + 0.5f};
+            r.push_quad(cell_centre, config.cell_size, config.cell_size, 0, cell_colour);
+        });
     }
 
     // draw the boundaries of the regions
@@ -75,13 +97,20 @@ auto draw_constraints(renderer& r, const sudoku_board& board, const board_render
     }
 }
 
-// draw border
-auto draw_border(renderer& r, const render_config& config)
+// draw border around each grid
+auto draw_border(renderer& r, const sudoku_board& board, const render_config& config)
 {
-    r.push_line(config.tl, config.tr, from_hex(0xecf0f1), 2.5f);
-    r.push_line(config.tr, config.br, from_hex(0xecf0f1), 2.5f);
-    r.push_line(config.br, config.bl, from_hex(0xecf0f1), 2.5f);
-    r.push_line(config.bl, config.tl, from_hex(0xecf0f1), 2.5f);
+    const auto extent = board.digits() * config.cell_size;
+    for (const auto grid : board.grids()) {
+        const auto tl = config.tl + config.cell_size * glm::vec2{grid.x, grid.y};
+        const auto tr = tl + glm::vec2{extent, 0};
+        const auto bl = tl + glm::vec2{0, extent};
+        const auto br = tl + glm::vec2{extent, extent};
+        r.push_line(tl, tr, from_hex(0xecf0f1), 2.5f);
+        r.push_line(tr, br, from_hex(0xecf0f1), 2.5f);
+        r.push_line(br, bl, from_hex(0xecf0f1), 2.5f);
+        r.push_line(bl, tl, from_hex(0xecf0f1), 2.5f);
+    }
 }
 
 auto ease_out_quint(f32 time) -> f32
@@ -110,14 +139,14 @@ auto draw_digits(renderer& r, const sudoku_board& board, const board_render_stat
                     const auto dt = std::chrono::duration<double>(config.now - inner->time).count();
                     colour = lerp(colour, from_hex(0xff9ff3), solved_ease(dt, 0.1f * float(x + y)));
                 }
-                r.push_text_box(std::format("{}", *cell.value), cell_top_left, config.cell_size, config.cell_size, scale, colour);
+                r.push_text_box(std::string(1, to_symbol(*cell.value)), cell_top_left, config.cell_size, config.cell_size, scale, colour);
                 continue; // only render the main digit if it's given
             }
 
             if (!cell.centre_pencil_marks.empty()) {
                 auto s = std::string{};
                 for (auto mark : cell.centre_pencil_marks) {
-                    s.append(std::to_string(mark));
+                    s.push_back(to_symbol(mark));
                 }
                 const auto length = 2 * r.font().length_of(s);
                 const auto scale = length > config.cell_size ? 1 : 2;
@@ -127,7 +156,7 @@ auto draw_digits(renderer& r, const sudoku_board& board, const board_render_stat
             if (!cell.corner_pencil_marks.empty()) {
                 auto s = std::string{};
                 for (auto mark : cell.corner_pencil_marks) {
-                    s.append(std::to_string(mark));
+                    s.push_back(to_symbol(mark));
                 }
                 const auto length = 2 * r.font().length_of(s);
                 const auto scale = length > config.cell_size ? 1 : 2;
@@ -142,6 +171,11 @@ auto draw_digits(renderer& r, const sudoku_board& board, const board_render_stat
 
 }
 
+auto board_margin(const sudoku_board& board) -> i32
+{
+    return std::ranges::any_of(board.constraints, [](const auto& c) { return c->outside_clue(); }) ? 1 : 0;
+}
+
 void draw_board(
     renderer& r,
     glm::vec2 screen_dimensions,
@@ -149,14 +183,18 @@ void draw_board(
     const board_render_state& state,
     const time_point& now)
 {
-    const auto board_size = 0.9f * std::min(screen_dimensions.x, screen_dimensions.y);
+    // The grid and its margin share the space, so outside clues aren't clipped
+    const auto margin = board_margin(board);
+    const auto space = 0.9f * std::min(screen_dimensions.x, screen_dimensions.y);
+    const auto cell_size = space / (board.size() + 2 * margin);
+    const auto board_size = cell_size * board.size();
     const auto board_centre = screen_dimensions / 2.0f;
     const auto top_left = board_centre - glm::vec2{board_size, board_size} / 2.0f;
 
     const auto config = render_config{
         .board_size = board_size,
         .board_centre = board_centre,
-        .cell_size = board_size / board.size(),
+        .cell_size = cell_size,
         .tl = top_left,
         .tr = top_left + glm::vec2{board_size, 0},
         .bl = top_left + glm::vec2{0, board_size},
@@ -165,9 +203,10 @@ void draw_board(
     };
 
     draw_backboard(r, board, config);
+    draw_geometry(r, board, config);
     draw_highlighted(r, board, config);
     draw_constraints(r, board, state, config);
-    draw_border(r, config);
+    draw_border(r, board, config);
 
     // draw the renbans (and others...)
     for (const auto& c : board.constraints) {
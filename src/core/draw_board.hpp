@@ -1,10 +1,10 @@
 #pragma once
 #include "renderer.hpp"
 #include "sudoku.hpp"
+#include "cell_bits.hpp"
 #include "utility.hpp"
 
 #include <variant>
-#include <unordered_set>
 
 namespace sudoku {
 
@@ -34,7 +34,7 @@ struct normal_rs
 struct empty_cells_rs
 {
     time_point time;
-    std::unordered_set<glm::ivec2> cells;
+    cell_bits  cells;
 };
 
 // Error state for when the board is filled but the constraints dont hold
@@ -56,6 +56,9 @@ using board_render_state = std::variant<
     solved_rs
 >;
 
+// The number of cells left free on each side of the grid, one if any clue is drawn outside it
+auto board_margin(const sudoku_board& board) -> i32;
+
 void draw_board(
     renderer& r,
     glm::vec2 screen_dimensions,
@@ -0,0 +1,210 @@
+#include "exact_cover.hpp"
+#include "solver_stats.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+// The matrix as parallel arrays of node links. Nodes [0, column count] are the column
+// headers, with node 0 as the root that links the uncovered columns together. Secondary
+// columns are left out of the root's list, so they may be covered at most once rather
+// than exactly once.
+class dancing_links
+{
+    std::vector<i32> d_left;
+    std::vector<i32> d_right;
+    std::vector<i32> d_up;
+    std::vector<i32> d_down;
+    std::vector<i32> d_column;
+    std::vector<i32> d_row;
+    std::vector<i32> d_size;        // live nodes in each column
+    std::vector<i32> d_row_start;   // first node of each row
+
+public:
+    explicit dancing_links(i32 columns, i32 secondary = 0)
+    {
+        for (i32 i = 0; i <= columns + secondary; ++i) push_node(i, -1);
+        for (i32 i = 0; i <= columns; ++i) {
+            d_left[i] = i == 0 ? columns : i - 1;
+            d_right[i] = i == columns ? 0 : i + 1;
+        }
+        d_size.assign(columns + secondary + 1, 0);
+    }
+
+    auto push_node(i32 column, i32 row) -> i32
+    {
+        const auto node = static_cast<i32>(d_left.size());
+        d_left.push_back(node);
+        d_right.push_back(node);
+        d_up.push_back(node);
+        d_down.push_back(node);
+        d_column.push_back(column);
+        d_row.push_back(row);
+        return node;
+    }
+
+    auto add_row(std::span<const i32> columns) -> void
+    {
+        const auto row = static_cast<i32>(d_row_start.size());
+        auto first = -1;
+        for (const auto column : columns) {
+            const auto node = push_node(column + 1, row);
+            d_up[node] = d_up[column + 1];
+            d_down[node] = column + 1;
+            d_down[d_up[column + 1]] = node;
+            d_up[column + 1] = node;
+            ++d_size[column + 1];
+            if (first == -1) {
+                first = node;
+            } else {
+                d_left[node] = d_left[first];
+                d_right[node] = first;
+                d_right[d_left[first]] = node;
+                d_left[first] = node;
+            }
+        }
+        d_row_start.push_back(first);
+    }
+
+    auto cover(i32 column) -> void
+    {
+        d_right[d_left[column]] = d_right[column];
+        d_left[d_right[column]] = d_left[column];
+        for (auto i = d_down[column]; i != column; i = d_down[i]) {
+            for (auto j = d_right[i]; j != i; j = d_right[j]) {
+                d_down[d_up[j]] = d_down[j];
+                d_up[d_down[j]] = d_up[j];
+                --d_size[d_column[j]];
+            }
+        }
+    }
+
+    auto uncover(i32 column) -> void
+    {
+        for (auto i = d_up[column]; i != column; i = d_up[i]) {
+            for (auto j = d_left[i]; j != i; j = d_left[j]) {
+                ++d_size[d_column[j]];
+                d_down[d_up[j]] = j;
+                d_up[d_down[j]] = j;
+            }
+        }
+        d_right[d_left[column]] = column;
+        d_left[d_right[column]] = column;
+    }
+
+    // Removes a row and every row clashing with it, returns false if it was already clashing
+    auto select(i32 row, std::vector<u8>& covered) -> bool
+    {
+        const auto first = d_row_start[row];
+        auto node = first;
+        do {
+            if (covered[d_column[node]]) return false;
+            covered[d_column[node]] = 1;
+            cover(d_column[node]);
+            node = d_right[node];
+        } while (node != first);
+        return true;
+    }
+
+    template <typename Leaf>
+    auto search(std::vector<i32>& rows, const std::stop_token& stop, solver_stats* stats, Leaf&& leaf) -> bool
+    {
+        if (stop.stop_requested()) return false;
+        if (stats) ++stats->nodes;
+        if (d_right[0] == 0) return leaf(rows);
+
+        // Branch on the column with the fewest rows left
+        auto best = d_right[0];
+        for (auto c = d_right[best]; c != 0; c = d_right[c]) {
+            if (d_size[c] < d_size[best]) best = c;
+        }
+        if (d_size[best] == 0) {
+            if (stats) ++stats->backtracks;
+            return false;
+        }
+
+        cover(best);
+        for (auto r = d_down[best]; r != best; r = d_down[r]) {
+            rows.push_back(d_row[r]);
+            for (auto j = d_right[r]; j != r; j = d_right[j]) cover(d_column[j]);
+            if (search(rows, stop, stats, leaf)) return true;
+            for (auto j = d_left[r]; j != r; j = d_left[j]) uncover(d_column[j]);
+            rows.pop_back();
+        }
+        uncover(best);
+        return false;
+    }
+};
+
+}
+
+auto solve_exact_cover(const sudoku_board& board, std::stop_token stop) -> std::optional<solution>
+{
+    const auto size = static_cast<i32>(board.digits());
+    const auto& cells = board.cells();
+    const auto cell_count = static_cast<i32>(cells.size());
+
+    // Only houses with a cell for every digit demand that every digit appears in them
+    auto houses_of = std::vector<std::vector<i32>>(cells.size());
+    auto house_count = i32{0};
+    for (const auto& house : board.houses()) {
+        if (house.size() != board.digits()) continue;
+        for (const auto cell : house) houses_of[cell].push_back(house_count);
+        ++house_count;
+    }
+
+    // Peers that share no full house, such as the cells a knight's move apart, get a
+    // secondary column per digit so both cells can't take the same digit
+    const auto primary = cell_count + house_count * size;
+    auto pairs_of = std::vector<std::vector<i32>>(cells.size());
+    auto pair_count = i32{0};
+    for (i32 cell = 0; cell != cell_count; ++cell) {
+        for (const auto peer : board.peers(cell)) {
+            if (peer < cell || std::ranges::find_first_of(houses_of[cell], houses_of[peer]) != houses_of[cell].end()) continue;
+            pairs_of[cell].push_back(pair_count);
+            pairs_of[peer].push_back(pair_count);
+            ++pair_count;
+        }
+    }
+
+    auto matrix = dancing_links{primary, pair_count * size};
+    auto columns = std::vector<i32>{};
+    for (i32 cell = 0; cell != cell_count; ++cell) {
+        for (i32 digit = 1; digit <= size; ++digit) {
+            columns.assign(1, cell);
+            for (const auto house : houses_of[cell]) {
+                columns.push_back(cell_count + house * size + (digit - 1));
+            }
+            for (const auto pair : pairs_of[cell]) {
+                columns.push_back(primary + pair * size + (digit - 1));
+            }
+            matrix.add_row(columns);
+        }
+    }
+
+    auto covered = std::vector<u8>(primary + pair_count * size + 1, 0);
+    auto rows = std::vector<i32>{};
+    for (i32 cell = 0; cell != cell_count; ++cell) {
+        // Cells outside every grid are in no house, so any row covers them
+        if (!cells[cell].value.has_value() && cells[cell].active) continue;
+        const auto row = cell * size + (cells[cell].active ? *cells[cell].value - 1 : 0);
+        if (!matrix.select(row, covered)) return {};
+        rows.push_back(row);
+    }
+
+    auto result = std::optional<solution>{};
+    matrix.search(rows, stop, current_stats(), [&](const std::vector<i32>& chosen) {
+        auto values = solution(cells.size());
+        for (const auto row : chosen) {
+            if (cells[row / size].active) values[row / size] = row % size + 1;
+        }
+        if (!board.constraints.empty() && !is_solved(board.with_values(values))) return false;
+        result = std::move(values);
+        return true;
+    });
+    return result;
+}
+
+}
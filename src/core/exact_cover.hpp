@@ -0,0 +1,15 @@
+#pragma once
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <optional>
+#include <stop_token>
+
+namespace sudoku {
+
+// Solves the board as an exact cover problem with Knuth's dancing links. Each row of the
+// matrix places a digit in a cell and covers that cell along with the digit in each of the
+// cell's houses. Constraints are checked against each complete cover.
+auto solve_exact_cover(const sudoku_board& board, std::stop_token stop = {}) -> std::optional<solution>;
+
+}
@@ -0,0 +1,152 @@
+#include "generator.hpp"
+#include "grid_table.hpp"
+#include "solver.hpp"
+#include "solver_stats.hpp"
+#include "rng.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
+namespace sudoku {
+namespace {
+
+// A multiplier unrelated to the one rng's seeding adds, so neighbouring attempts don't
+// start on overlapping states
+constexpr u64 attempt_stride = 0xd1342543de82ef95;
+
+auto uniform(rng& gen, u64 bound) -> u64
+{
+    return std::uniform_int_distribution<u64>(0, bound - 1)(gen);
+}
+
+// A completed grid on the layout. Small layouts draw one from their grid table. Otherwise
+// a handful of digits are placed in random cells first, each one propagated so it can't
+// clash with the ones before, and the solver fills in the rest around them.
+auto random_grid(const sudoku_board& layout, rng& gen) -> std::optional<solution>
+{
+    if (grid_table::supports(layout)) {
+        if (const auto table = grid_table::shared(layout); table && table->grid_count() > 0) return table->random_grid(gen);
+    }
+
+    const auto root = initial_state(layout);
+    if (!root) return {};
+
+    auto queue = std::vector<u16>{};
+    auto open = std::vector<u16>{};
+    for (u64 retry = 0; retry != 8; ++retry) {
+        auto state = *root;
+        auto consistent = true;
+        for (u64 placed = 0; placed != layout.digits() && consistent; ++placed) {
+            open.clear();
+            for (std::size_t cell = 0; cell != state.candidates.size(); ++cell) {
+                if (std::popcount(state.candidates[cell]) > 1) open.push_back(static_cast<u16>(cell));
+            }
+            if (open.empty()) break;
+
+            const auto cell = open[uniform(gen, open.size())];
+            auto mask = state.candidates[cell];
+            for (auto skip = uniform(gen, static_cast<u64>(std::popcount(mask))); skip; --skip) mask &= mask - 1;
+            state.candidates[cell] = lowest_bit(mask);
+            queue.assign(1, cell);
+            consistent = propagate_state(layout, state, queue);
+        }
+        if (!consistent) continue;
+        if (auto values = solve_from(layout, state)) return values;
+    }
+    return {};
+}
+
+auto within_cap(const logical_rating& rating, const difficulty_band& band) -> bool
+{
+    return rating.solved && rating.hardest <= band.hardest;
+}
+
+// One attempt at a puzzle in the band, or nothing if this grid didn't give one
+auto attempt(const sudoku_board& layout, const difficulty_band& band, rng gen) -> std::optional<generated_puzzle>
+{
+    auto values = random_grid(layout, gen);
+    if (!values) return {};
+
+    auto order = std::vector<u16>{};
+    const auto& cells = layout.cells();
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (cells[i].active) order.push_back(static_cast<u16>(i));
+    }
+    std::ranges::shuffle(order, gen);
+
+    // Uniqueness is the cheaper check, so the logical solver only runs on removals that
+    // pass it
+    for (const auto cell : order) {
+        const auto given = std::exchange((*values)[cell], 0);
+        const auto puzzle = layout.with_values(*values);
+        if (count_solutions(puzzle, 2) == 1 && within_cap(rate_puzzle(puzzle), band)) continue;
+        (*values)[cell] = given;
+    }
+
+    auto puzzle = layout.with_values(*values);
+    const auto rating = rate_puzzle(puzzle);
+    if (!within_cap(rating, band) || rating.hardest < band.easiest) return {};
+    return generated_puzzle{std::move(puzzle), rating};
+}
+
+}
+
+auto generate_puzzles(const sudoku_board& layout, const generator_options& options) -> std::vector<generated_puzzle>
+{
+    const auto blank = layout.with_values(solution(layout.cells().size(), 0));
+
+    auto threads = options.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, options.max_attempts);
+
+    // Attempts are handed out in order and no new ones start once enough puzzles are in.
+    // Every attempt before the last one started has then finished, so the first count
+    // successes among them are the first count overall.
+    auto next = std::atomic<u64>{0};
+    auto lock = std::mutex{};
+    auto found = std::vector<std::pair<u64, generated_puzzle>>{};
+
+    auto* caller_stats = current_stats();
+    auto stats = std::vector<solver_stats>(threads);
+    {
+        auto workers = std::vector<std::jthread>{};
+        for (u64 id = 0; id != threads; ++id) {
+            workers.emplace_back([&, id] {
+                auto scope = std::optional<stats_scope>{};
+                if (caller_stats) scope.emplace(stats[id]);
+                while (!options.stop.stop_requested()) {
+                    {
+                        const auto guard = std::scoped_lock{lock};
+                        if (found.size() >= options.count) return;
+                    }
+                    const auto index = next++;
+                    if (index >= options.max_attempts) return;
+
+                    auto puzzle = attempt(blank, options.band, rng{options.seed + index * attempt_stride});
+                    if (!puzzle) continue;
+
+                    const auto guard = std::scoped_lock{lock};
+                    found.emplace_back(index, std::move(*puzzle));
+                }
+            });
+        }
+    }
+
+    if (caller_stats) {
+        for (const auto& s : stats) *caller_stats += s;
+    }
+    std::ranges::sort(found, {}, &std::pair<u64, generated_puzzle>::first);
+    auto puzzles = std::vector<generated_puzzle>{};
+    for (auto& [index, puzzle] : found) {
+        if (puzzles.size() == options.count) break;
+        puzzles.push_back(std::move(puzzle));
+    }
+    return puzzles;
+}
+
+}
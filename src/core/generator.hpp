@@ -0,0 +1,43 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "logical_solver.hpp"
+
+#include <stop_token>
+#include <vector>
+
+namespace sudoku {
+
+// Puzzles are kept if the hardest technique they need lies in [easiest, hardest]
+struct difficulty_band
+{
+    technique easiest = technique::naked_single;
+    technique hardest = technique::pattern_overlay;
+};
+
+struct generator_options
+{
+    difficulty_band band         = {};
+    u64             count        = 1;    // puzzles wanted
+    u64             max_attempts = 1000; // grids tried before giving up on the rest
+    u64             seed         = 0;
+    u64             threads      = 0;    // 0 uses one per hardware thread
+    std::stop_token stop         = {};
+};
+
+struct generated_puzzle
+{
+    sudoku_board   board;
+    logical_rating rating;
+};
+
+// Makes puzzles on the layout of the given board, whose digits are ignored. Each attempt
+// fills a random grid and removes givens in a random order, skipping any removal that
+// would allow a second solution or push the puzzle past the hardest technique of the
+// band, then keeps the result if it needs at least the easiest. Attempts run in parallel
+// but each draws from its own seed, so the puzzles returned, in attempt order, are the
+// same whatever the thread count. Only the houses are used for rating, as rate_puzzle
+// does, so the layout should carry no constraints.
+auto generate_puzzles(const sudoku_board& layout, const generator_options& options) -> std::vector<generated_puzzle>;
+
+}
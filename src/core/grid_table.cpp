@@ -0,0 +1,252 @@
+#include "grid_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <print>
+#include <random>
+
+namespace sudoku {
+namespace {
+
+constexpr u64 table_magic = 0x32424154'44495247; // "GRIDTAB2"
+
+using digit_map = std::array<i32, grid_table::max_size + 1>;
+
+auto layout_of(const sudoku_board& board) -> std::vector<i32>
+{
+    auto regions = std::vector<i32>{};
+    for (const auto& cell : board.cells()) regions.push_back(cell.region.value_or(-1));
+    return regions;
+}
+
+auto bits_for(u64 size) -> u64
+{
+    return std::max<u64>(std::bit_width(size - 1), 1);
+}
+
+// Cells never straddle two words
+auto words_for(u64 size, u64 bits) -> u64
+{
+    const auto per_word = 64 / bits;
+    return (size * size + per_word - 1) / per_word;
+}
+
+auto factorial(u64 n) -> u64
+{
+    u64 result = 1;
+    for (u64 i = 2; i <= n; ++i) result *= i;
+    return result;
+}
+
+}
+
+auto grid_table::digit(u64 grid, u64 cell) const -> i32
+{
+    const auto per_word = 64 / d_bits;
+    const auto word = d_grids[grid * d_words + cell / per_word];
+    return static_cast<i32>((word >> (cell % per_word * d_bits)) & ((u64{1} << d_bits) - 1)) + 1;
+}
+
+template <typename Func>
+auto grid_table::for_each_match(const sudoku_board& board, Func&& fn) const -> void
+{
+    auto givens = std::vector<std::pair<u64, i32>>{};
+    const auto& cells = board.cells();
+    for (u64 i = 0; i != cells.size(); ++i) {
+        if (cells[i].value) givens.emplace_back(i, *cells[i].value);
+    }
+
+    for (u64 grid = 0; grid != grid_count(); ++grid) {
+        auto map = digit_map{};
+        u64 used = 0;
+        u64 mapped = 0;
+        auto agrees = true;
+        for (const auto& [cell, value] : givens) {
+            auto& target = map[digit(grid, cell)];
+            if (target == value) continue;
+            if (target != 0 || (used >> value) & 1) {
+                agrees = false;
+                break;
+            }
+            target = value;
+            used |= u64{1} << value;
+            ++mapped;
+        }
+        if (agrees && fn(grid, map, mapped)) return;
+    }
+}
+
+auto grid_table::build(const sudoku_board& layout) -> std::optional<grid_table>
+{
+    const auto size = layout.size();
+    if (size > max_size) {
+        std::print("grid_table failed - boards larger than {0}x{0} have too many grids\n", max_size);
+        return {};
+    }
+    if (layout.grids().size() != 1) {
+        std::print("grid_table failed - multi-grid boards are not supported\n");
+        return {};
+    }
+    if (!layout.constraints.empty()) {
+        std::print("grid_table failed - constraints break the relabelling symmetry\n");
+        return {};
+    }
+
+    auto table = grid_table{};
+    table.d_size = size;
+    table.d_regions = layout_of(layout);
+    table.d_geometry = layout.geometry();
+    table.d_bits = bits_for(size);
+    table.d_words = words_for(size, table.d_bits);
+    const auto per_word = 64 / table.d_bits;
+
+    // Pinning the first row to 1..size picks one grid from each relabelling class
+    auto values = std::vector<i32>(size * size, 0);
+    std::iota(values.begin(), values.begin() + size, 1);
+    const auto pinned = layout.with_values(values);
+
+    for (const auto& grid : solutions(pinned)) {
+        const auto start = table.d_grids.size();
+        table.d_grids.resize(start + table.d_words, 0);
+        for (u64 cell = 0; cell != grid.size(); ++cell) {
+            table.d_grids[start + cell / per_word] |= static_cast<u64>(grid[cell] - 1) << (cell % per_word * table.d_bits);
+        }
+    }
+    return table;
+}
+
+auto grid_table::supports(const sudoku_board& layout) -> bool
+{
+    return layout.size() <= max_size && layout.grids().size() == 1 && layout.constraints.empty();
+}
+
+auto grid_table::shared(const sudoku_board& layout) -> const grid_table*
+{
+    static auto lock = std::mutex{};
+    static auto tables = std::vector<std::unique_ptr<grid_table>>{};
+    if (!supports(layout)) return nullptr;
+
+    const auto guard = std::scoped_lock{lock};
+    for (const auto& table : tables) {
+        if (table->matches(layout)) return table.get();
+    }
+    auto table = build(layout);
+    if (!table) return nullptr;
+    return tables.emplace_back(std::make_unique<grid_table>(std::move(*table))).get();
+}
+
+auto grid_table::load(const std::filesystem::path& path) -> std::optional<grid_table>
+{
+    auto file = std::ifstream{path, std::ios::binary};
+    if (!file) {
+        std::print("grid_table failed - could not open {}\n", path.string());
+        return {};
+    }
+
+    auto header = std::array<u64, 6>{}; // magic, size, geometry, bits, words, grids
+    file.read(reinterpret_cast<char*>(header.data()), sizeof(header));
+    const auto size = header[1];
+    if (!file || header[0] != table_magic || size == 0 || size > max_size
+        || header[3] != bits_for(size) || header[4] != words_for(size, header[3])) {
+        std::print("grid_table failed - {} is not a grid table\n", path.string());
+        return {};
+    }
+
+    // The grid count is checked against the file's length before anything is allocated
+    auto error = std::error_code{};
+    const auto bytes = std::filesystem::file_size(path, error);
+    const auto fixed = sizeof(header) + size * size * sizeof(i32);
+    if (error || bytes < fixed || header[5] > (bytes - fixed) / (header[4] * sizeof(u64))) {
+        std::print("grid_table failed - {} is truncated\n", path.string());
+        return {};
+    }
+
+    auto table = grid_table{};
+    table.d_size = size;
+    table.d_geometry = static_cast<int>(header[2]);
+    table.d_bits = header[3];
+    table.d_words = header[4];
+    table.d_regions.resize(size * size);
+    table.d_grids.resize(header[4] * header[5]);
+    file.read(reinterpret_cast<char*>(table.d_regions.data()), table.d_regions.size() * sizeof(i32));
+    file.read(reinterpret_cast<char*>(table.d_grids.data()), table.d_grids.size() * sizeof(u64));
+    if (!file) {
+        std::print("grid_table failed - {} is truncated\n", path.string());
+        return {};
+    }
+    return table;
+}
+
+auto grid_table::save(const std::filesystem::path& path) const -> bool
+{
+    auto file = std::ofstream{path, std::ios::binary};
+    const auto header = std::array<u64, 6>{table_magic, d_size, static_cast<u64>(d_geometry), d_bits, d_words, grid_count()};
+    file.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+    file.write(reinterpret_cast<const char*>(d_regions.data()), d_regions.size() * sizeof(i32));
+    file.write(reinterpret_cast<const char*>(d_grids.data()), d_grids.size() * sizeof(u64));
+    if (!file) {
+        std::print("grid_table failed - could not write {}\n", path.string());
+        return false;
+    }
+    return true;
+}
+
+auto grid_table::matches(const sudoku_board& board) const -> bool
+{
+    return board.size() == d_size && board.grids().size() == 1 && board.geometry() == d_geometry && layout_of(board) == d_regions;
+}
+
+auto grid_table::solve(const sudoku_board& board) const -> std::optional<solution>
+{
+    assert(matches(board));
+    auto result = std::optional<solution>{};
+    for_each_match(board, [&](u64 grid, digit_map map, u64) {
+        // Digits the board doesn't pin down take whatever board digits are left, in order
+        u64 used = 0;
+        for (const auto value : map) used |= u64{1} << value;
+        auto next = i32{1};
+        for (i32 d = 1; d <= static_cast<i32>(d_size); ++d) {
+            if (map[d] != 0) continue;
+            while ((used >> next) & 1) ++next;
+            map[d] = next++;
+        }
+
+        auto& values = result.emplace(d_size * d_size);
+        for (u64 cell = 0; cell != values.size(); ++cell) values[cell] = map[digit(grid, cell)];
+        return true;
+    });
+    return result;
+}
+
+auto grid_table::count_solutions(const sudoku_board& board, u64 limit) const -> u64
+{
+    assert(matches(board));
+    u64 count = 0;
+    for_each_match(board, [&](u64, const digit_map&, u64 mapped) {
+        // Each unmapped table digit can go to any unused board digit
+        count += factorial(d_size - mapped);
+        return count >= limit;
+    });
+    return std::min(count, limit);
+}
+
+auto grid_table::random_grid(rng& gen) const -> solution
+{
+    assert(grid_count() > 0);
+    const auto grid = std::uniform_int_distribution<u64>(0, grid_count() - 1)(gen);
+    auto relabel = digit_map{};
+    std::iota(relabel.begin(), relabel.end(), 0);
+    std::shuffle(relabel.begin() + 1, relabel.begin() + d_size + 1, gen);
+
+    auto values = solution(d_size * d_size);
+    for (u64 cell = 0; cell != values.size(); ++cell) values[cell] = relabel[digit(grid, cell)];
+    return values;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+#include "rng.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace sudoku {
+
+// Every solution grid of a small board layout. Relabelling the digits of a grid gives
+// another grid, so only the relabelling whose first row reads 1 to size is kept, which
+// cuts 6x6 from 28 million grids to 39 thousand. Grids are packed a few bits per cell.
+//
+// Lookups answer for the houses alone, the board's constraints are ignored.
+class grid_table
+{
+    u64              d_size = 0;
+    std::vector<i32> d_regions;      // the region of every cell, or -1
+    int              d_geometry = 0; // with the regions, identifies the layout
+    u64              d_bits = 0;     // per cell
+    u64              d_words = 0;    // per grid
+    std::vector<u64> d_grids;
+
+    auto digit(u64 grid, u64 cell) const -> i32;
+
+    // Calls fn(grid, map, mapped) for every grid some relabelling of which agrees with
+    // the board's digits. map sends table digits to board digits for the mapped digits.
+    // Stops when fn returns true.
+    template <typename Func>
+    auto for_each_match(const sudoku_board& board, Func&& fn) const -> void;
+
+public:
+    static constexpr u64 max_size = 6;
+
+    // Enumerates every grid of the layout, the digits on the board are ignored
+    static auto build(const sudoku_board& layout) -> std::optional<grid_table>;
+
+    // True for layouts build accepts: one grid of at most max_size with no constraints
+    static auto supports(const sudoku_board& layout) -> bool;
+
+    // The table of the layout, built the first time any thread asks for it and kept for
+    // the rest of the run, or nullptr if the layout isn't supported
+    static auto shared(const sudoku_board& layout) -> const grid_table*;
+
+    static auto load(const std::filesystem::path& path) -> std::optional<grid_table>;
+    auto save(const std::filesystem::path& path) const -> bool;
+
+    auto size() const -> u64 { return d_size; }
+    auto grid_count() const -> u64 { return d_words ? d_grids.size() / d_words : 0; }
+
+    // True if the board has the layout the table was built for
+    auto matches(const sudoku_board& board) const -> bool;
+
+    auto solve(const sudoku_board& board) const -> std::optional<solution>;
+    auto count_solutions(const sudoku_board& board, u64 limit = u64_max) const -> u64;
+    auto random_grid(rng& gen) const -> solution;
+};
+
+}
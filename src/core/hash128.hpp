@@ -0,0 +1,46 @@
+#pragma once
+#include "common.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace sudoku {
+
+// The splitmix64 finaliser
+constexpr auto mix64(u64 x) -> u64
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// Two independent 64-bit hashes of a sequence of words, used as a key in place of the
+// state that was hashed, which keeps keys small. Two different states would have to agree
+// on all 128 bits to be confused.
+struct hash128
+{
+    u64 first = 0;
+    u64 second = 0x9e3779b97f4a7c15;
+
+    constexpr auto add(u64 word) -> void
+    {
+        first = mix64(first ^ word);
+        second = mix64(second + word * 0xd1342543de82ef95);
+    }
+
+    constexpr auto add(std::string_view text) -> void
+    {
+        add(text.size());
+        for (const auto c : text) add(static_cast<u8>(c));
+    }
+
+    auto operator==(const hash128&) const -> bool = default;
+};
+
+// For hash maps keyed by hash128, whose halves are already well mixed
+struct hash128_hasher
+{
+    auto operator()(const hash128& key) const -> std::size_t { return key.first; }
+};
+
+}
@@ -0,0 +1,131 @@
+#include "incremental_solver.hpp"
+
+#include <cassert>
+
+namespace sudoku {
+
+incremental_solver::incremental_solver(const sudoku_board& board)
+    : d_layout{board.with_values(solution(board.cells().size(), 0))}
+    , d_assigned(board.cells().size(), 0)
+{
+    auto base = initial_state(d_layout);
+    d_layout_broken = !base.has_value();
+    if (base) d_state = std::move(*base);
+    sync(board);
+}
+
+auto incremental_solver::rewind(std::size_t level) -> void
+{
+    if (level >= d_applied) return;
+    const auto target = d_levels[level].trail_size;
+    while (d_trail.size() > target) {
+        const auto& entry = d_trail.back();
+        d_state.candidates[entry.cell] = entry.candidates;
+        d_state.placed[entry.cell] = entry.placed;
+        d_trail.pop_back();
+    }
+    d_applied = level;
+}
+
+auto incremental_solver::apply_pending() -> u64
+{
+    if (d_layout_broken) return 0;
+
+    u64 count = 0;
+    auto queue = std::vector<u16>{};
+    while (d_applied != d_levels.size()) {
+        auto& next = d_levels[d_applied];
+        const auto bit = digit_bit(next.digit);
+        if (!(d_state.candidates[next.cell] & bit)) return count;
+
+        // Propagate into a copy and keep only what changed on the trail, so the hot loops
+        // of the solver don't have to log anything
+        auto after = d_state;
+        after.candidates[next.cell] = bit;
+        queue.assign(1, next.cell);
+        if (!propagate_state(d_layout, after, queue)) return count;
+
+        next.trail_size = d_trail.size();
+        for (std::size_t cell = 0; cell != after.candidates.size(); ++cell) {
+            if (after.candidates[cell] != d_state.candidates[cell] || after.placed[cell] != d_state.placed[cell]) {
+                d_trail.push_back({static_cast<u16>(cell), d_state.placed[cell], d_state.candidates[cell]});
+            }
+        }
+        d_state = std::move(after);
+        ++d_applied;
+        ++count;
+    }
+    return count;
+}
+
+auto incremental_solver::sync(const sudoku_board& board) -> u64
+{
+    const auto& cells = board.cells();
+    assert(cells.size() == d_assigned.size());
+
+    // Everything from the first digit that has changed or gone is rewound, then the digits
+    // after it that are still there go back on in their old order
+    auto first = d_levels.size();
+    for (std::size_t i = 0; i != d_levels.size(); ++i) {
+        if (cells[d_levels[i].cell].value != d_levels[i].digit) {
+            first = i;
+            break;
+        }
+    }
+    if (first != d_levels.size()) {
+        rewind(first);
+        auto kept = std::vector<level>{};
+        for (std::size_t i = first; i != d_levels.size(); ++i) {
+            d_assigned[d_levels[i].cell] = 0;
+            if (cells[d_levels[i].cell].value == d_levels[i].digit) kept.push_back(d_levels[i]);
+        }
+        d_levels.resize(first);
+        for (const auto& l : kept) {
+            d_levels.push_back(l);
+            d_assigned[l.cell] = 1;
+        }
+        // Fewer digits keep a solution valid, but can give one to a board that had none
+        if (!d_solution) d_solution_known = false;
+    }
+
+    for (std::size_t cell = 0; cell != cells.size(); ++cell) {
+        if (!cells[cell].value || d_assigned[cell]) continue;
+        const auto digit = *cells[cell].value;
+        d_levels.push_back({static_cast<u16>(cell), digit, d_trail.size()});
+        d_assigned[cell] = 1;
+        if (d_solution && (*d_solution)[cell] != digit) d_solution_known = false;
+    }
+
+    return apply_pending();
+}
+
+auto incremental_solver::consistent() const -> bool
+{
+    return !d_layout_broken && d_applied == d_levels.size();
+}
+
+auto incremental_solver::candidates() const -> std::span<const digit_mask>
+{
+    return d_state.candidates;
+}
+
+auto incremental_solver::solve() -> const std::optional<solution>&
+{
+    if (!d_solution_known) {
+        d_solution = consistent() ? solve_from(d_layout, d_state) : std::nullopt;
+        d_solution_known = true;
+    }
+    return d_solution;
+}
+
+auto incremental_solver::hint() const -> std::optional<std::pair<u16, i32>>
+{
+    if (!consistent()) return {};
+    for (std::size_t cell = 0; cell != d_state.candidates.size(); ++cell) {
+        const auto mask = d_state.candidates[cell];
+        if (!d_assigned[cell] && std::has_single_bit(mask)) return std::pair{static_cast<u16>(cell), lowest_digit(mask)};
+    }
+    return {};
+}
+
+}
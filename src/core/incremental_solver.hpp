@@ -0,0 +1,70 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace sudoku {
+
+// Keeps the propagated candidates of a board between edits so that analysis after a single
+// change doesn't start from scratch. Each digit on the board is a level: placing it pushes
+// the cells its propagation changed onto a trail, so taking a digit away rewinds the trail
+// to that level and re-propagates only the digits placed after it. A solution found once
+// is reused for as long as the digits on the board agree with it.
+class incremental_solver
+{
+    struct level
+    {
+        u16         cell;
+        i32         digit;
+        std::size_t trail_size; // trail length before this digit was propagated
+    };
+
+    struct trail_entry
+    {
+        u16        cell;
+        u8         placed;
+        digit_mask candidates;
+    };
+
+    sudoku_board             d_layout; // the board with its digits removed
+    grid_state               d_state;
+    std::vector<level>       d_levels;
+    std::vector<trail_entry> d_trail;
+    std::vector<u8>          d_assigned; // cells with a level
+    std::size_t              d_applied = 0; // levels propagated into the state, the rest wait behind a contradiction
+    std::optional<solution>  d_solution;
+    bool                     d_solution_known = false;
+    bool                     d_layout_broken = false; // the constraints fail with no digits at all
+
+    // Pulls the state back to before the given level
+    auto rewind(std::size_t level) -> void;
+
+    // Propagates the levels not yet in the state until one contradicts, returns how many went in
+    auto apply_pending() -> u64;
+
+public:
+    explicit incremental_solver(const sudoku_board& board);
+
+    // Brings the state in line with the digits now on the board, which must have the
+    // layout the solver was made with. Returns the number of levels re-propagated.
+    auto sync(const sudoku_board& board) -> u64;
+
+    // False if the digits on the board contradict each other or the constraints
+    auto consistent() const -> bool;
+
+    auto candidates() const -> std::span<const digit_mask>;
+
+    // A completion of the digits on the board, searched for only when the last one found
+    // no longer fits
+    auto solve() -> const std::optional<solution>&;
+
+    // A cell the propagation has solved that the board doesn't show yet, with its digit
+    auto hint() const -> std::optional<std::pair<u16, i32>>;
+};
+
+}
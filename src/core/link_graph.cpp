@@ -0,0 +1,71 @@
+#include "link_graph.hpp"
+
+namespace sudoku {
+
+link_graph::link_graph(const sudoku_board& board, std::span<const digit_mask> candidates)
+    : d_size{board.digits()}
+{
+    const auto cells = board.cells().size();
+    for (const auto& house : board.houses()) {
+        if (house.size() == d_size) d_houses.push_back(house);
+    }
+
+    auto houses_of = std::vector<std::vector<u32>>(cells);
+    for (u32 h = 0; h != d_houses.size(); ++h) {
+        for (const auto cell : d_houses[h]) houses_of[cell].push_back(h);
+    }
+    d_house_offset.push_back(0);
+    for (const auto& ids : houses_of) {
+        d_house_ids.insert(d_house_ids.end(), ids.begin(), ids.end());
+        d_house_offset.push_back(static_cast<u32>(d_house_ids.size()));
+    }
+
+    d_links.assign(cells + d_houses.size() * d_size, {no_link, no_link});
+    for (u64 cell = 0; cell != cells; ++cell) refresh_cell(cell, candidates);
+    for (u64 house = 0; house != d_houses.size(); ++house) {
+        for (i32 digit = 1; digit <= static_cast<i32>(d_size); ++digit) refresh_house(house, digit, candidates);
+    }
+}
+
+auto link_graph::house_unit(u64 house, i32 digit) const -> u64
+{
+    return d_house_offset.size() - 1 + house * d_size + (digit - 1);
+}
+
+auto link_graph::refresh_cell(u64 cell, std::span<const digit_mask> candidates) -> void
+{
+    auto& link = d_links[cell_unit(cell)];
+    const auto mask = candidates[cell];
+    if (std::popcount(mask) != 2) {
+        link = {no_link, no_link};
+        return;
+    }
+    const auto base = static_cast<candidate>(cell * d_size);
+    link = {base + std::countr_zero(mask), base + (63 - std::countl_zero(mask))};
+}
+
+auto link_graph::refresh_house(u64 house, i32 digit, std::span<const digit_mask> candidates) -> void
+{
+    auto& link = d_links[house_unit(house, digit)];
+    link = {no_link, no_link};
+
+    const auto bit = digit_bit(digit);
+    auto found = u64{0};
+    auto ends = std::array<u32, 2>{};
+    for (const auto cell : d_houses[house]) {
+        if (!(candidates[cell] & bit)) continue;
+        if (found == 2) return;
+        ends[found++] = static_cast<candidate>(cell * d_size + (digit - 1));
+    }
+    if (found == 2) link = ends;
+}
+
+auto link_graph::on_eliminate(u64 cell, i32 digit, std::span<const digit_mask> candidates) -> void
+{
+    refresh_cell(cell, candidates);
+    for (auto i = d_house_offset[cell]; i != d_house_offset[cell + 1]; ++i) {
+        refresh_house(d_house_ids[i], digit, candidates);
+    }
+}
+
+}
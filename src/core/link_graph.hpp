@@ -0,0 +1,69 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace sudoku {
+
+// A candidate is a digit in a cell, numbered cell * size + digit - 1
+using candidate = u32;
+
+enum class link_kind : u8
+{
+    cell,  // the only two digits left in a cell
+    house, // the only two places left for a digit in a house
+};
+
+// The strong links between candidates: pairs where one of the two must be true. Every
+// strong link comes from a unit, either a cell or a (house, digit) pair, that has exactly
+// two candidates left. Each candidate belongs to a fixed set of units and each unit holds
+// at most one link, so the adjacency is two flat arrays, and an elimination only needs to
+// refresh the handful of units the candidate belongs to.
+//
+// Weak links (two candidates that cannot both be true) follow directly from the peer
+// tables and the candidates, so they are never stored.
+class link_graph
+{
+    static constexpr u32 no_link = ~u32{0};
+
+    u64                           d_size = 0;
+    std::vector<std::vector<u16>> d_houses;       // only the houses that need every digit
+    std::vector<u32>              d_house_offset; // houses of each cell, as offsets into
+    std::vector<u32>              d_house_ids;    // d_house_ids, one past the end per cell
+    std::vector<std::array<u32, 2>> d_links;      // the two ends of each unit's link
+
+    auto cell_unit(u64 cell) const -> u64 { return cell; }
+    auto house_unit(u64 house, i32 digit) const -> u64;
+    auto refresh_cell(u64 cell, std::span<const digit_mask> candidates) -> void;
+    auto refresh_house(u64 house, i32 digit, std::span<const digit_mask> candidates) -> void;
+
+public:
+    link_graph() = default;
+    link_graph(const sudoku_board& board, std::span<const digit_mask> candidates);
+
+    // Call after removing digit from cell, with the candidates already updated
+    auto on_eliminate(u64 cell, i32 digit, std::span<const digit_mask> candidates) -> void;
+
+    // Calls fn(other, kind) for every candidate strongly linked to c
+    template <typename Func>
+    auto for_each_strong(candidate c, Func&& fn) const -> void
+    {
+        const auto cell = c / d_size;
+        const auto digit = static_cast<i32>(c % d_size) + 1;
+        const auto visit = [&](u64 unit, link_kind kind) {
+            const auto& [a, b] = d_links[unit];
+            if (a == c) fn(b, kind);
+            else if (b == c) fn(a, kind);
+        };
+        visit(cell_unit(cell), link_kind::cell);
+        for (auto i = d_house_offset[cell]; i != d_house_offset[cell + 1]; ++i) {
+            visit(house_unit(d_house_ids[i], digit), link_kind::house);
+        }
+    }
+};
+
+}
@@ -0,0 +1,479 @@
+#include "logical_solver.hpp"
+#include "solver_stats.hpp"
+
+#include <algorithm>
+
+namespace sudoku {
+namespace {
+
+// Longer chains are rarely needed and make every failed search slower
+constexpr u8 max_chain_links = 16;
+
+// Partial templates explored per digit before pattern overlay gives up on it
+constexpr u64 max_template_nodes = u64{1} << 16;
+
+// Calls fn(chosen, covers) for each set of n base houses whose cover masks, OR'd together,
+// name at most n cover houses. chosen has bit i set for masks[i]. Stops when fn returns true.
+template <typename Func>
+auto for_each_fish(std::span<const u64> masks, u64 n, u64 start, u64 chosen, u64 covers, Func&& fn) -> bool
+{
+    if (static_cast<u64>(std::popcount(covers)) > n) return false;
+    if (static_cast<u64>(std::popcount(chosen)) == n) return fn(chosen, covers);
+    for (auto i = start; i < masks.size(); ++i) {
+        if (for_each_fish(masks, n, i + 1, chosen | (u64{1} << i), covers | masks[i], fn)) return true;
+    }
+    return false;
+}
+
+}
+
+// Which links a chain may use. Strong links come from bivalue cells or bilocal house
+// digits, weak links join two candidates in one cell or one digit in two peer cells.
+struct logical_solver::chain_rules
+{
+    bool cell_strong;
+    bool house_strong;
+    bool cell_weak;
+};
+
+auto to_string(technique t) -> std::string_view
+{
+    switch (t) {
+        case technique::naked_single:    return "naked_single";
+        case technique::hidden_single:   return "hidden_single";
+        case technique::x_wing:          return "x_wing";
+        case technique::swordfish:       return "swordfish";
+        case technique::jellyfish:       return "jellyfish";
+        case technique::x_chain:         return "x_chain";
+        case technique::xy_chain:        return "xy_chain";
+        case technique::aic:             return "aic";
+        case technique::pattern_overlay: return "pattern_overlay";
+    }
+    return "unknown";
+}
+
+logical_solver::logical_solver(const sudoku_board& board)
+    : d_board{&board}
+    , d_size{board.digits()}
+{
+    const auto& cells = board.cells();
+    const auto full = all_digits(d_size);
+    d_candidates.assign(cells.size(), full);
+    d_placed.assign(cells.size(), 0);
+
+    d_peer_cells.resize(cells.size());
+    for (u64 cell = 0; cell != cells.size(); ++cell) {
+        for (const auto peer : board.peers(cell)) d_peer_cells[cell].set(peer);
+    }
+
+    // Rows and columns come first in the house list, then the regions, then any houses
+    // the geometry adds, which can overlap each other and so form no family. The grids of
+    // a multi-grid board overlap too, so a house only joins its family if it is disjoint
+    // from the houses already in it.
+    const auto& houses = board.houses();
+    auto family_cells = std::array<cell_bits, 3>{};
+    for (auto& index : d_family_index) index.assign(cells.size(), no_house);
+    for (u64 h = 0; h != houses.size(); ++h) {
+        auto& house = d_house_cells.emplace_back();
+        for (const auto cell : houses[h]) house.set(cell);
+
+        const auto family = h < board.first_column_house() ? 0 : h < board.first_region_house() ? 1 : 2;
+        if (h >= board.first_extra_house() || houses[h].size() != d_size || d_families[family].size() == 63) continue;
+        if ((family_cells[family] & house).any()) continue;
+        family_cells[family] |= house;
+        for (const auto cell : houses[h]) d_family_index[family][cell] = static_cast<u8>(d_families[family].size());
+        d_families[family].push_back(static_cast<u16>(h));
+        d_fish_stride = std::max<u64>(d_fish_stride, d_families[family].size());
+    }
+
+    // Givens are applied before the link graph exists so it is built once, not refreshed
+    // for every elimination
+    for (u64 cell = 0; cell != cells.size(); ++cell) {
+        if (!cells[cell].active) {
+            // Cells outside every grid have no candidates and count as placed
+            d_candidates[cell] = 0;
+            d_placed[cell] = 1;
+            continue;
+        }
+        if (!cells[cell].value) {
+            ++d_unsolved;
+            continue;
+        }
+        const auto bit = digit_bit(*cells[cell].value);
+        d_candidates[cell] = bit;
+        d_placed[cell] = 1;
+        for (const auto peer : board.peers(cell)) d_candidates[peer] &= ~bit;
+    }
+    for (u64 cell = 0; cell != cells.size(); ++cell) {
+        if (cells[cell].active && (d_candidates[cell] & full) == 0) d_broken = true;
+    }
+
+    d_digit_cells.resize(d_size);
+    for (u64 cell = 0; cell != cells.size(); ++cell) {
+        for (auto mask = d_candidates[cell] & full; mask; mask &= mask - 1) {
+            d_digit_cells[std::countr_zero(mask)].set(cell);
+        }
+    }
+
+    d_links = link_graph{board, d_candidates};
+    d_seen.assign(cells.size() * d_size * 2, 0);
+}
+
+auto logical_solver::sees(u64 a, u64 b) const -> bool
+{
+    return d_peer_cells[a].test(b);
+}
+
+auto logical_solver::is_weak(candidate a, candidate b) const -> bool
+{
+    const auto cell_a = a / d_size;
+    const auto cell_b = b / d_size;
+    if (cell_a == cell_b) return a != b;
+    return a % d_size == b % d_size && sees(cell_a, cell_b);
+}
+
+template <typename Func>
+auto logical_solver::for_each_weak(candidate c, bool within_cell, Func&& fn) const -> void
+{
+    const auto cell = c / d_size;
+    const auto digit = static_cast<i32>(c % d_size) + 1;
+    if (within_cell) {
+        for (auto mask = d_candidates[cell] & ~digit_bit(digit); mask; mask &= mask - 1) {
+            fn(static_cast<candidate>(cell * d_size + std::countr_zero(mask)));
+        }
+    }
+    const auto bit = digit_bit(digit);
+    for (const auto peer : d_board->peers(cell)) {
+        if (d_candidates[peer] & bit) fn(static_cast<candidate>(peer * d_size + (digit - 1)));
+    }
+}
+
+auto logical_solver::eliminate(u64 cell, i32 digit) -> bool
+{
+    auto& mask = d_candidates[cell];
+    const auto bit = digit_bit(digit);
+    if (!(mask & bit)) return false;
+    mask &= ~bit;
+    if (mask == 0) d_broken = true;
+    d_digit_cells[digit - 1].reset(cell);
+    d_links.on_eliminate(cell, digit, d_candidates);
+    return true;
+}
+
+auto logical_solver::place(u64 cell, i32 digit) -> void
+{
+    for (auto mask = d_candidates[cell] & ~digit_bit(digit); mask; mask &= mask - 1) {
+        eliminate(cell, lowest_digit(mask));
+    }
+    for (const auto peer : d_board->peers(cell)) eliminate(peer, digit);
+    d_placed[cell] = 1;
+    --d_unsolved;
+}
+
+auto logical_solver::find_naked_single() -> std::optional<logical_step>
+{
+    for (u64 cell = 0; cell != d_candidates.size(); ++cell) {
+        if (d_placed[cell] || !std::has_single_bit(d_candidates[cell])) continue;
+        const auto digit = lowest_digit(d_candidates[cell]);
+        place(cell, digit);
+        return logical_step{technique::naked_single, {{static_cast<u16>(cell), digit}}, {}};
+    }
+    return {};
+}
+
+auto logical_solver::find_hidden_single() -> std::optional<logical_step>
+{
+    for (const auto& house : d_board->houses()) {
+        if (house.size() != d_size) continue;
+        digit_mask once = 0;
+        digit_mask twice = 0;
+        for (const auto cell : house) {
+            const auto mask = d_candidates[cell];
+            twice |= once & mask;
+            once |= mask;
+        }
+        const auto hidden = once & ~twice;
+        if (!hidden) continue;
+        for (const auto cell : house) {
+            if (d_placed[cell] || !(d_candidates[cell] & hidden)) continue;
+            const auto digit = lowest_digit(d_candidates[cell] & hidden);
+            place(cell, digit);
+            return logical_step{technique::hidden_single, {{cell, digit}}, {}};
+        }
+    }
+    return {};
+}
+
+// Fills in, for every digit and every pair of families, where the digit can go in each
+// base house as a mask of cover house indices. Bit 63 marks a cell no cover house holds.
+auto logical_solver::build_fish_masks() -> void
+{
+    d_fish_masks.assign(d_size * 9 * d_fish_stride, 0);
+    for (u64 digit = 0; digit != d_size; ++digit) {
+        d_digit_cells[digit].for_each([&](u64 cell) {
+            for (u64 base = 0; base != 3; ++base) {
+                const auto base_index = d_family_index[base][cell];
+                if (base_index == no_house) continue;
+                for (u64 cover = 0; cover != 3; ++cover) {
+                    if (base == cover) continue;
+                    const auto cover_index = d_family_index[cover][cell];
+                    const auto bit = cover_index == no_house ? 63 : cover_index;
+                    d_fish_masks[((digit * 3 + base) * 3 + cover) * d_fish_stride + base_index] |= u64{1} << bit;
+                }
+            }
+        });
+    }
+}
+
+// Looks for n base houses in one family whose candidates for the digit all lie within n
+// cover houses of another. The n copies of the digit in the base houses fill the cover
+// houses, so the digit can go from the rest of the cover houses.
+auto logical_solver::fish_in(i32 digit, u64 base, u64 cover, u64 n) -> std::optional<logical_step>
+{
+    const auto* masks = &d_fish_masks[((static_cast<u64>(digit - 1) * 3 + base) * 3 + cover) * d_fish_stride];
+    d_fish_bases.clear();
+    d_fish_covers.clear();
+    for (u64 i = 0; i != d_families[base].size(); ++i) {
+        // A house with one place left for the digit is a single, not part of a fish
+        if (std::popcount(masks[i]) < 2 || (masks[i] >> 63)) continue;
+        d_fish_bases.push_back(i);
+        d_fish_covers.push_back(masks[i]);
+    }
+    if (d_fish_covers.size() < n) return {};
+
+    // When the base family covers the board, the digit's other places in the cover houses
+    // all lie in the other base houses, so most sets are ruled out from the masks alone
+    const auto partitions = d_families[base].size() * d_size == d_candidates.size();
+    const auto& cells = d_digit_cells[digit - 1];
+    auto victims = cell_bits{};
+    const auto found = for_each_fish(d_fish_covers, n, 0, 0, 0, [&](u64 chosen, u64 covers) {
+        if (partitions) {
+            auto in_base = u64{0};
+            for (auto rest = chosen; rest; rest &= rest - 1) in_base |= u64{1} << d_fish_bases[std::countr_zero(rest)];
+            auto outside = u64{0};
+            for (u64 i = 0; i != d_families[base].size(); ++i) {
+                if (!((in_base >> i) & 1)) outside |= masks[i] & covers;
+            }
+            if (!outside) return false;
+        }
+        auto base_cells = cell_bits{};
+        for (; chosen; chosen &= chosen - 1) base_cells |= d_house_cells[d_families[base][d_fish_bases[std::countr_zero(chosen)]]];
+        auto cover_cells = cell_bits{};
+        for (; covers; covers &= covers - 1) cover_cells |= d_house_cells[d_families[cover][std::countr_zero(covers)]];
+        victims = (cells & cover_cells).subtract(base_cells);
+        return victims.any();
+    });
+    if (!found) return {};
+
+    auto step = logical_step{static_cast<technique>(static_cast<u64>(technique::x_wing) + n - 2), {}, {}};
+    victims.for_each([&](u64 cell) {
+        step.eliminations.emplace_back(static_cast<u16>(cell), digit);
+        eliminate(cell, digit);
+    });
+    return step;
+}
+
+auto logical_solver::find_fish() -> std::optional<logical_step>
+{
+    build_fish_masks();
+    for (u64 n = 2; n <= 4; ++n) {
+        for (i32 digit = 1; digit <= static_cast<i32>(d_size); ++digit) {
+            for (u64 base = 0; base != d_families.size(); ++base) {
+                for (u64 cover = 0; cover != d_families.size(); ++cover) {
+                    if (base == cover) continue;
+                    if (auto step = fish_in(digit, base, cover, n)) return step;
+                }
+            }
+        }
+    }
+    return {};
+}
+
+// Places the digit in each row in turn, avoiding the peers of the cells already chosen,
+// and folds every complete template into the union and the common cells
+auto logical_solver::search_templates(i32 digit, u64 row, const cell_bits& blocked, cell_bits& chosen) -> void
+{
+    if (d_template_budget == 0) return;
+    --d_template_budget;
+
+    if (row == d_families[0].size()) {
+        if (d_template_count++ == 0) d_template_common = chosen;
+        else d_template_common &= chosen;
+        d_template_union |= chosen;
+        return;
+    }
+
+    auto options = d_digit_cells[digit - 1] & d_house_cells[d_families[0][row]];
+    options.subtract(blocked);
+    options.for_each([&](u64 cell) {
+        chosen.set(cell);
+        search_templates(digit, row + 1, blocked | d_peer_cells[cell], chosen);
+        chosen.reset(cell);
+    });
+}
+
+// Pattern overlay: a candidate that appears in no complete template for its digit can go,
+// and a cell that appears in every template must hold the digit
+auto logical_solver::find_template() -> std::optional<logical_step>
+{
+    if (d_families[0].size() != d_size) return {};
+    for (i32 digit = 1; digit <= static_cast<i32>(d_size); ++digit) {
+        d_template_union = cell_bits{};
+        d_template_common = cell_bits{};
+        d_template_count = 0;
+        d_template_budget = max_template_nodes;
+
+        auto chosen = cell_bits{};
+        search_templates(digit, 0, cell_bits{}, chosen);
+        if (d_template_budget == 0 || d_template_count == 0) continue;
+
+        auto step = logical_step{technique::pattern_overlay, {}, {}};
+        auto victims = d_digit_cells[digit - 1];
+        victims.subtract(d_template_union);
+        victims.for_each([&](u64 cell) { step.eliminations.emplace_back(static_cast<u16>(cell), digit); });
+        d_template_common.for_each([&](u64 cell) {
+            if (!d_placed[cell]) step.placements.emplace_back(static_cast<u16>(cell), digit);
+        });
+        if (step.eliminations.empty() && step.placements.empty()) continue;
+
+        for (const auto& [cell, d] : step.eliminations) eliminate(cell, d);
+        for (const auto& [cell, d] : step.placements) place(cell, d);
+        return step;
+    }
+    return {};
+}
+
+// A breadth first search of the implications of the start candidate being false. Strong
+// links turn a false candidate into a true one and weak links turn a true candidate into a
+// false one, so every path is an alternating chain. Reaching a candidate as true means
+// either it or the start holds, so anything weakly linked to both can go. Reaching one
+// candidate as both true and false means the start cannot be false.
+auto logical_solver::chain_from(candidate start, technique kind, const chain_rules& rules) -> std::optional<logical_step>
+{
+    const auto mark = [&](candidate node, u8 on) -> bool {
+        auto& seen = d_seen[node * 2 + on];
+        if (seen == d_search) return false;
+        seen = d_search;
+        return true;
+    };
+    const auto contradicts = [&](candidate node, u8 on) {
+        return d_seen[node * 2 + (on ^ 1)] == d_search;
+    };
+    const auto conclude_true = [&]() {
+        const auto cell = start / d_size;
+        const auto digit = static_cast<i32>(start % d_size) + 1;
+        place(cell, digit);
+        return logical_step{kind, {{static_cast<u16>(cell), digit}}, {}};
+    };
+
+    d_queue.clear();
+    d_victims.clear();
+    mark(start, 0);
+    d_queue.push_back({start, 0, 0});
+
+    for (std::size_t head = 0; head != d_queue.size(); ++head) {
+        const auto entry = d_queue[head];
+        if (entry.links == max_chain_links) continue;
+        const auto links = static_cast<u8>(entry.links + 1);
+
+        if (entry.on) {
+            auto found = false;
+            for_each_weak(entry.node, rules.cell_weak, [&](candidate next) {
+                if (found || !mark(next, 0)) return;
+                if (contradicts(next, 0)) found = true;
+                d_queue.push_back({next, 0, links});
+            });
+            if (found) return conclude_true();
+            continue;
+        }
+
+        auto found = false;
+        d_links.for_each_strong(entry.node, [&](candidate next, link_kind link) {
+            if (found) return;
+            if (link == link_kind::cell ? !rules.cell_strong : !rules.house_strong) return;
+            if (!mark(next, 1)) return;
+            if (contradicts(next, 1)) {
+                found = true;
+                return;
+            }
+            d_queue.push_back({next, 1, links});
+
+            for_each_weak(start, true, [&](candidate victim) {
+                if (victim != next && is_weak(victim, next)) d_victims.push_back(victim);
+            });
+            found = !d_victims.empty();
+        });
+        if (!found) continue;
+        if (d_victims.empty()) return conclude_true();
+
+        auto step = logical_step{kind, {}, {}};
+        for (const auto victim : d_victims) {
+            const auto cell = victim / d_size;
+            const auto digit = static_cast<i32>(victim % d_size) + 1;
+            step.eliminations.emplace_back(static_cast<u16>(cell), digit);
+            eliminate(cell, digit);
+        }
+        return step;
+    }
+    return {};
+}
+
+auto logical_solver::find_chain(technique kind, const chain_rules& rules) -> std::optional<logical_step>
+{
+    for (u64 cell = 0; cell != d_candidates.size(); ++cell) {
+        if (d_placed[cell]) continue;
+        if (rules.cell_strong && !rules.house_strong && std::popcount(d_candidates[cell]) != 2) continue;
+        for (auto mask = d_candidates[cell]; mask; mask &= mask - 1) {
+            if (++d_search == 0) {
+                std::ranges::fill(d_seen, 0);
+                d_search = 1;
+            }
+            const auto start = static_cast<candidate>(cell * d_size + std::countr_zero(mask));
+            if (auto step = chain_from(start, kind, rules)) return step;
+        }
+    }
+    return {};
+}
+
+auto logical_solver::step() -> std::optional<logical_step>
+{
+    if (d_broken || d_unsolved == 0) return {};
+    auto* stats = current_stats();
+
+    auto result = find_naked_single();
+    if (!result) result = find_hidden_single();
+    if (!result) {
+        const auto timer = phase_timer{stats, "fish_search"};
+        result = find_fish();
+    }
+    if (!result) {
+        const auto timer = phase_timer{stats, "chain_search"};
+        result = find_chain(technique::x_chain, {.cell_strong = false, .house_strong = true, .cell_weak = false});
+        if (!result) result = find_chain(technique::xy_chain, {.cell_strong = true, .house_strong = false, .cell_weak = false});
+        if (!result) result = find_chain(technique::aic, {.cell_strong = true, .house_strong = true, .cell_weak = true});
+    }
+    if (!result) {
+        const auto timer = phase_timer{stats, "template_search"};
+        result = find_template();
+    }
+
+    if (result && stats) {
+        stats->technique_hits.add(to_string(result->kind), 1);
+        stats->prunes.add("logical", result->eliminations.size());
+    }
+    return result;
+}
+
+auto rate_puzzle(const sudoku_board& board) -> logical_rating
+{
+    auto solver = logical_solver{board};
+    auto rating = logical_rating{};
+    while (const auto step = solver.step()) {
+        rating.hardest = std::max(rating.hardest, step->kind);
+        ++rating.steps;
+    }
+    rating.solved = solver.solved();
+    return rating;
+}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+#include "link_graph.hpp"
+#include "cell_bits.hpp"
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sudoku {
+
+// The deductions the logical solver knows, from easiest to hardest
+enum class technique : u8
+{
+    naked_single,
+    hidden_single,
+    x_wing,
+    swordfish,
+    jellyfish,
+    x_chain,
+    xy_chain,
+    aic,
+    pattern_overlay,
+};
+
+auto to_string(technique t) -> std::string_view;
+
+struct logical_step
+{
+    technique                        kind;
+    std::vector<std::pair<u16, i32>> placements;   // (cell, digit) pairs that were filled in
+    std::vector<std::pair<u16, i32>> eliminations; // (cell, digit) pairs that were ruled out
+};
+
+// Solves a puzzle the way a person would, one deduction at a time, always taking the
+// easiest one available. Only the houses are used, other constraints are ignored. The
+// board must outlive the solver.
+class logical_solver
+{
+    struct chain_rules;
+    struct chain_entry
+    {
+        candidate node;
+        u8        on;    // the node is true if the start is false, otherwise it is false
+        u8        links; // links from the start
+    };
+
+    static constexpr u8 no_house = 0xff;
+
+    const sudoku_board*     d_board;
+    u64                     d_size;
+    u64                     d_unsolved = 0;
+    bool                    d_broken = false;
+    std::vector<digit_mask> d_candidates;
+    std::vector<u8>         d_placed;
+    link_graph              d_links;
+
+    // Position bitboards, kept up to date alongside the candidates
+    std::vector<cell_bits> d_digit_cells; // per digit, the cells it can still go in
+    std::vector<cell_bits> d_house_cells; // per house
+    std::vector<cell_bits> d_peer_cells;  // per cell
+
+    // The rows, columns and regions as three families of disjoint houses, and for each
+    // cell its index in each family
+    std::array<std::vector<u16>, 3> d_families;
+    std::array<std::vector<u8>, 3>  d_family_index;
+
+    // Chain search scratch, kept between steps so searching never allocates
+    std::vector<u32>         d_seen; // per (candidate, on), the search that reached it
+    u32                      d_search = 0;
+    std::vector<chain_entry> d_queue;
+    std::vector<candidate>   d_victims;
+
+    // Fish and template search scratch
+    std::vector<u64>         d_fish_masks;  // see build_fish_masks
+    u64                      d_fish_stride = 0; // houses in the largest family, the mask rows per pair
+    std::vector<u64>         d_fish_bases;  // the family indices of one search's base houses
+    std::vector<u64>         d_fish_covers; // and the cover houses each one touches
+    cell_bits                d_template_union;
+    cell_bits                d_template_common;
+    u64                      d_template_count = 0;
+    u64                      d_template_budget = 0;
+
+    auto sees(u64 a, u64 b) const -> bool;
+    auto is_weak(candidate a, candidate b) const -> bool;
+    template <typename Func>
+    auto for_each_weak(candidate c, bool within_cell, Func&& fn) const -> void;
+
+    auto eliminate(u64 cell, i32 digit) -> bool;
+    auto place(u64 cell, i32 digit) -> void;
+
+    auto find_naked_single() -> std::optional<logical_step>;
+    auto find_hidden_single() -> std::optional<logical_step>;
+    auto build_fish_masks() -> void;
+    auto find_fish() -> std::optional<logical_step>;
+    auto fish_in(i32 digit, u64 base, u64 cover, u64 n) -> std::optional<logical_step>;
+    auto find_template() -> std::optional<logical_step>;
+    auto search_templates(i32 digit, u64 row, const cell_bits& blocked, cell_bits& chosen) -> void;
+    auto find_chain(technique kind, const chain_rules& rules) -> std::optional<logical_step>;
+    auto chain_from(candidate start, technique kind, const chain_rules& rules) -> std::optional<logical_step>;
+
+public:
+    explicit logical_solver(const sudoku_board& board);
+
+    // Applies the easiest deduction available, or returns nothing if there is none
+    auto step() -> std::optional<logical_step>;
+
+    auto solved() const -> bool { return d_unsolved == 0 && !d_broken; }
+    auto broken() const -> bool { return d_broken; } // a cell ran out of candidates
+    auto candidates() const -> std::span<const digit_mask> { return d_candidates; }
+};
+
+struct logical_rating
+{
+    bool      solved  = false;
+    technique hardest = technique::naked_single;
+    u64       steps   = 0;
+};
+
+// Runs the logical solver to the end, the hardest technique needed rates the puzzle
+auto rate_puzzle(const sudoku_board& board) -> logical_rating;
+
+}
@@ -0,0 +1,83 @@
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#define SUDOKU_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define SUDOKU_HAS_MMAP 0
+#endif
+
+namespace sudoku {
+namespace {
+
+#if SUDOKU_HAS_MMAP
+auto map(const std::filesystem::path& path, mapped_file::access mode, std::size_t& size) -> void*
+{
+    const auto writable = mode == mapped_file::access::read_write;
+    const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return MAP_FAILED;
+
+    struct stat info = {};
+    auto data = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        size = static_cast<std::size_t>(info.st_size);
+        data = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED && !writable) ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+    return data;
+}
+#endif
+
+}
+
+auto mapped_file::open(const std::filesystem::path& path, access mode) -> std::optional<mapped_file>
+{
+    auto file = mapped_file{};
+#if SUDOKU_HAS_MMAP
+    if (const auto data = map(path, mode, file.d_size); data != MAP_FAILED) {
+        file.d_data = static_cast<std::byte*>(data);
+        file.d_mapped = true;
+        return file;
+    }
+    file.d_size = 0;
+#endif
+
+    // Empty files can't be mapped, and without mmap only reading is possible
+    if (mode == access::read_write) return {};
+    auto stream = std::ifstream{path, std::ios::binary};
+    if (!stream) return {};
+    auto error = std::error_code{};
+    const auto bytes = std::filesystem::file_size(path, error);
+    if (error) return {};
+
+    file.d_buffer.resize(bytes);
+    stream.read(reinterpret_cast<char*>(file.d_buffer.data()), static_cast<std::streamsize>(bytes));
+    if (!stream) return {};
+    file.d_data = file.d_buffer.data();
+    file.d_size = file.d_buffer.size();
+    return file;
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : d_data{std::exchange(other.d_data, nullptr)}
+    , d_size{std::exchange(other.d_size, 0)}
+    , d_mapped{std::exchange(other.d_mapped, false)}
+    , d_buffer{std::move(other.d_buffer)}
+{
+}
+
+mapped_file::~mapped_file()
+{
+#if SUDOKU_HAS_MMAP
+    if (d_mapped) ::munmap(d_data, d_size);
+#endif
+}
+
+}
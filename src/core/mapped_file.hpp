@@ -0,0 +1,39 @@
+#pragma once
+#include "common.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace sudoku {
+
+// The whole of a file in memory. Where the platform has mmap the file is mapped, otherwise
+// a read-only file is read into a buffer and writable files can't be opened. Writes to a
+// writable file are shared with every other process that has it open.
+class mapped_file
+{
+    std::byte*             d_data = nullptr;
+    std::size_t            d_size = 0;
+    bool                   d_mapped = false;
+    std::vector<std::byte> d_buffer; // the contents when the file isn't mapped
+
+    mapped_file() = default;
+
+public:
+    enum class access { read, read_write };
+
+    // Read-only files are read front to back, which the platform is told if it can use it
+    static auto open(const std::filesystem::path& path, access mode) -> std::optional<mapped_file>;
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&&) = delete;
+    ~mapped_file();
+
+    auto data() const -> std::byte* { return d_data; }
+    auto size() const -> std::size_t { return d_size; }
+    auto view() const -> std::string_view { return {reinterpret_cast<const char*>(d_data), d_size}; }
+};
+
+}
@@ -0,0 +1,121 @@
+#include "minimizer.hpp"
+#include "solver.hpp"
+#include "solver_stats.hpp"
+#include "rng.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <deque>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+// Whether the solution stays unique with every one of cells emptied
+auto removal_keeps_unique(const sudoku_board& solved, solution values, std::span<const u16> cells) -> bool
+{
+    for (const auto cell : cells) values[cell] = 0;
+    return count_solutions(solved.with_values(values), 2) == 1;
+}
+
+}
+
+auto minimize_clues(const sudoku_board& solved, u64 seed, u64 threads) -> sudoku_board
+{
+    const auto& cells = solved.cells();
+    auto values = solution(cells.size());
+    auto order = std::vector<u16>{};
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (!cells[i].active) continue;
+        assert(cells[i].value.has_value());
+        values[i] = *cells[i].value;
+        order.push_back(static_cast<u16>(i));
+    }
+    std::ranges::shuffle(order, rng{seed});
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<u64>(threads, order.size());
+
+    // Each round the main thread publishes a batch of candidates from the front of pending
+    // and every worker tests one removal against the current givens. Removing more givens
+    // only adds solutions, so a removal that fails now fails for good, and one that keeps
+    // the solution unique with extra givens gone also does so with fewer gone.
+    //
+    // While most removals succeed, worker k tests removing the first k + 1 candidates all
+    // at once. The longest prefix that stays unique is exactly what the sequential pass
+    // would commit, and the candidate just after it fails against that prefix, so it is
+    // dropped. Once most removals fail, workers test one candidate each instead: the first
+    // success is committed, every failure is dropped and the later successes are retested
+    // against the new givens in the next round.
+    auto pending = std::deque<u16>(order.begin(), order.end());
+    auto batch = std::vector<u16>{};
+    auto results = std::vector<u8>(threads);
+    auto prefixes = true;
+    auto done = std::atomic<bool>{false};
+    auto sync = std::barrier{static_cast<std::ptrdiff_t>(threads + 1)};
+
+    // Each worker counts into its own stats, added to the caller's once they have joined
+    auto* caller_stats = current_stats();
+    auto stats = std::vector<solver_stats>(threads);
+
+    auto workers = std::vector<std::jthread>{};
+    for (u64 id = 0; id != threads; ++id) {
+        workers.emplace_back([&, id] {
+            auto scope = std::optional<stats_scope>{};
+            if (caller_stats) scope.emplace(stats[id]);
+            while (true) {
+                sync.arrive_and_wait(); // wait for a batch
+                if (done) return;
+                if (id < batch.size()) {
+                    const auto cells = prefixes ? std::span{batch}.first(id + 1) : std::span{batch}.subspan(id, 1);
+                    results[id] = removal_keeps_unique(solved, values, cells);
+                }
+                sync.arrive_and_wait(); // batch finished
+            }
+        });
+    }
+
+    while (!pending.empty()) {
+        const auto count = std::min<std::size_t>(threads, pending.size());
+        batch.assign(pending.begin(), pending.begin() + count);
+        pending.erase(pending.begin(), pending.begin() + count);
+
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+
+        const auto first = static_cast<std::size_t>(std::ranges::find(results.begin(), results.begin() + count, static_cast<u8>(!prefixes)) - results.begin());
+        if (prefixes) {
+            // Commit the prefix before the first failure, drop that one and put back the rest
+            for (std::size_t i = 0; i != first; ++i) values[batch[i]] = 0;
+            if (first + 1 < count) pending.insert(pending.begin(), batch.begin() + first + 1, batch.begin() + count);
+            prefixes = 2 * first >= count;
+        } else {
+            const auto successes = static_cast<std::size_t>(std::ranges::count(results.begin(), results.begin() + count, u8{1}));
+            if (first < count) {
+                values[batch[first]] = 0;
+                auto retest = std::vector<u16>{};
+                for (std::size_t i = first + 1; i != count; ++i) {
+                    if (results[i]) retest.push_back(batch[i]);
+                }
+                pending.insert(pending.begin(), retest.begin(), retest.end());
+            }
+            prefixes = 2 * successes > count;
+        }
+    }
+
+    done = true;
+    sync.arrive_and_wait();
+    workers.clear();
+
+    if (caller_stats) {
+        for (const auto& s : stats) *caller_stats += s;
+    }
+    return solved.with_values(values);
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+
+namespace sudoku {
+
+// Takes a board with every cell filled and removes givens one at a time, in an order
+// shuffled by seed, skipping any whose removal would allow a second solution. Removals
+// are tested speculatively in parallel batches, one test per thread, and a batch can
+// commit several removals at once. The result is the same as the sequential greedy pass
+// for a given seed, whatever the thread count.
+auto minimize_clues(const sudoku_board& solved, u64 seed, u64 threads = 0) -> sudoku_board;
+
+}
@@ -0,0 +1,185 @@
+#include "parallel_search.hpp"
+#include "solver_stats.hpp"
+
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+struct work_queue
+{
+    std::mutex             lock;
+    std::deque<grid_state> states; // the owner works from the back, thieves take the front
+};
+
+struct shared_search
+{
+    const sudoku_board&     board;
+    u64                     limit;
+    std::stop_token         caller_stop;
+    std::stop_source        done;
+    std::vector<work_queue> queues;
+    std::atomic<u64>        pending = 0; // states queued or being expanded
+    std::mutex              result_lock;
+    parallel_result         result;
+
+    auto stopped() const -> bool
+    {
+        return done.stop_requested() || caller_stop.stop_requested();
+    }
+};
+
+auto take_own(work_queue& queue) -> std::optional<grid_state>
+{
+    const auto guard = std::scoped_lock{queue.lock};
+    if (queue.states.empty()) return {};
+    auto state = std::move(queue.states.back());
+    queue.states.pop_back();
+    return state;
+}
+
+// Tries every other worker in turn, starting with the next one along so that thieves
+// spread out rather than all queueing on the same victim
+auto steal(shared_search& search, u64 thief) -> std::optional<grid_state>
+{
+    const auto count = search.queues.size();
+    for (u64 offset = 1; offset != count; ++offset) {
+        auto& victim = search.queues[(thief + offset) % count];
+        const auto guard = std::scoped_lock{victim.lock};
+        if (victim.states.empty()) continue;
+        auto state = std::move(victim.states.front());
+        victim.states.pop_front();
+        return state;
+    }
+    return {};
+}
+
+auto record_solution(shared_search& search, const grid_state& state, solver_stats* stats) -> void
+{
+    auto values = solution(state.candidates.size());
+    for (std::size_t i = 0; i != values.size(); ++i) {
+        values[i] = state.candidates[i] ? lowest_digit(state.candidates[i]) : 0;
+    }
+    if (!search.board.constraints.empty() && !is_solved(search.board.with_values(values))) {
+        if (stats) ++stats->backtracks;
+        return;
+    }
+
+    const auto guard = std::scoped_lock{search.result_lock};
+    if (search.result.found == search.limit) return;
+    if (search.result.found++ == 0) search.result.first = std::move(values);
+    if (search.result.found == search.limit) search.done.request_stop();
+}
+
+// Branches on a state, pushing each child that survives propagation onto the worker's own
+// queue with the lowest digit on top, so the worker goes depth first in the same order as
+// the sequential search
+auto expand(shared_search& search, work_queue& own, grid_state state, std::vector<u16>& queue, solver_stats* stats) -> void
+{
+    if (stats) ++stats->nodes;
+    const auto cell = branch_cell(state);
+    if (!cell) {
+        record_solution(search, state, stats);
+        return;
+    }
+
+    for (auto mask = state.candidates[*cell]; mask;) {
+        const auto bit = std::bit_floor(mask);
+        mask &= ~bit;
+
+        auto next = mask ? state : std::move(state);
+        next.candidates[*cell] = bit;
+        queue.assign(1, *cell);
+        if (!propagate_state(search.board, next, queue)) {
+            if (stats) ++stats->backtracks;
+            continue;
+        }
+
+        ++search.pending;
+        const auto guard = std::scoped_lock{own.lock};
+        own.states.push_back(std::move(next));
+    }
+}
+
+auto run_worker(shared_search& search, u64 id) -> void
+{
+    auto* stats = current_stats();
+    auto& own = search.queues[id];
+    auto queue = std::vector<u16>{};
+
+    while (!search.stopped()) {
+        auto state = take_own(own);
+        if (!state) state = steal(search, id);
+        if (!state) {
+            // Nothing is queued anywhere, and once nothing is being expanded either there
+            // never will be again
+            if (search.pending == 0) return;
+            std::this_thread::yield();
+            continue;
+        }
+        expand(search, own, std::move(*state), queue, stats);
+        --search.pending;
+    }
+}
+
+}
+
+auto search_parallel(const sudoku_board& board, u64 limit, const parallel_options& options) -> parallel_result
+{
+    if (limit == 0) return {};
+
+    auto root = std::optional<grid_state>{};
+    {
+        const auto timer = phase_timer{current_stats(), "propagation"};
+        root = initial_state(board);
+    }
+    if (!root) return {};
+
+    auto threads = options.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto search = shared_search{
+        .board = board,
+        .limit = limit,
+        .caller_stop = options.stop,
+        .queues = std::vector<work_queue>(threads)
+    };
+    search.queues[0].states.push_back(std::move(*root));
+    search.pending = 1;
+
+    auto* caller_stats = current_stats();
+    auto stats = std::vector<solver_stats>(threads);
+    {
+        const auto timer = phase_timer{caller_stats, "search"};
+        auto workers = std::vector<std::jthread>{};
+        for (u64 id = 0; id != threads; ++id) {
+            workers.emplace_back([&, id] {
+                auto scope = std::optional<stats_scope>{};
+                if (caller_stats) scope.emplace(stats[id]);
+                run_worker(search, id);
+            });
+        }
+    }
+
+    if (caller_stats) {
+        for (const auto& s : stats) *caller_stats += s;
+    }
+    return std::move(search.result);
+}
+
+auto solve_parallel(const sudoku_board& board, const parallel_options& options) -> std::optional<solution>
+{
+    return search_parallel(board, 1, options).first;
+}
+
+auto count_solutions_parallel(const sudoku_board& board, u64 limit, const parallel_options& options) -> u64
+{
+    return search_parallel(board, limit, options).found;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <optional>
+#include <stop_token>
+
+namespace sudoku {
+
+struct parallel_options
+{
+    std::stop_token stop    = {}; // every worker gives up once a stop is requested
+    u64             threads = 0;  // 0 uses one per hardware thread
+};
+
+struct parallel_result
+{
+    u64                     found = 0; // solutions seen, at most the limit
+    std::optional<solution> first;     // the first found, not always the one solve() finds
+};
+
+// Splits the search tree of a single puzzle across threads. Each worker goes depth first
+// through its own stack of propagated states, and a worker that runs dry steals the
+// shallowest state from another, which is the biggest subtree that worker has left. The
+// search stops for everyone once limit solutions are found, so a limit of 1 finds a
+// solution and a limit of 2 is a uniqueness check. Stats from every thread are merged
+// into the caller's collector.
+auto search_parallel(const sudoku_board& board, u64 limit, const parallel_options& options = {}) -> parallel_result;
+
+auto solve_parallel(const sudoku_board& board, const parallel_options& options = {}) -> std::optional<solution>;
+auto count_solutions_parallel(const sudoku_board& board, u64 limit = u64_max, const parallel_options& options = {}) -> u64;
+
+}
@@ -0,0 +1,78 @@
+#include "portfolio.hpp"
+#include "exact_cover.hpp"
+#include "solver_stats.hpp"
+
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+auto run_strategy(strategy s, const sudoku_board& board, std::stop_token stop) -> std::optional<solution>
+{
+    switch (s) {
+        case strategy::backtracking:
+            return solve(board, search_options{ .stop = stop });
+        case strategy::backtracking_reversed:
+            return solve(board, search_options{ .stop = stop, .reverse_digits = true });
+        case strategy::backjumping:
+            return solve(board, search_options{ .stop = stop, .backjumping = true });
+        case strategy::exact_cover:
+            return solve_exact_cover(board, stop);
+    }
+    return {};
+}
+
+}
+
+auto to_string(strategy s) -> std::string_view
+{
+    switch (s) {
+        case strategy::backtracking: return "backtracking";
+        case strategy::backtracking_reversed: return "backtracking_reversed";
+        case strategy::backjumping: return "backjumping";
+        case strategy::exact_cover: return "exact_cover";
+    }
+    return "unknown";
+}
+
+auto solve_portfolio(const sudoku_board& board, std::span<const strategy> strategies) -> portfolio_result
+{
+    assert(!strategies.empty());
+
+    auto* caller_stats = current_stats();
+    auto stats = std::vector<solver_stats>(strategies.size());
+
+    auto source = std::stop_source{};
+    auto lock = std::mutex{};
+    auto result = std::optional<portfolio_result>{};
+
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (std::size_t i = 0; i != strategies.size(); ++i) {
+            threads.emplace_back([&, i] {
+                auto scope = std::optional<stats_scope>{};
+                if (caller_stats) scope.emplace(stats[i]);
+
+                auto values = run_strategy(strategies[i], board, source.get_token());
+
+                // A stopped strategy returns nothing, but only ever after someone else has
+                // claimed the result, so the first to get here finished for real
+                const auto guard = std::scoped_lock{lock};
+                if (!result) {
+                    result = portfolio_result{ .values = std::move(values), .winner = strategies[i] };
+                    source.request_stop();
+                }
+            });
+        }
+    }
+
+    if (caller_stats) {
+        for (const auto& s : stats) *caller_stats += s;
+    }
+    return std::move(*result);
+}
+
+}
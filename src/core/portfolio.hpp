@@ -0,0 +1,41 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace sudoku {
+
+enum class strategy
+{
+    backtracking,          // candidate propagation with guesses in digit order
+    backtracking_reversed, // the same, guessing the largest digits first
+    backjumping,           // the same, jumping over decisions that played no part in a failure
+    exact_cover,           // dancing links
+};
+
+static constexpr auto all_strategies = std::array{
+    strategy::backtracking,
+    strategy::backtracking_reversed,
+    strategy::backjumping,
+    strategy::exact_cover,
+};
+
+auto to_string(strategy s) -> std::string_view;
+
+struct portfolio_result
+{
+    std::optional<solution> values;
+    strategy                winner;
+};
+
+// Races the strategies on separate threads, the first to finish stops the others. Puzzles
+// that stall one engine rarely stall them all, so this cuts the worst case rather than
+// the average. Stats from every thread are merged into the caller's collector.
+auto solve_portfolio(const sudoku_board& board, std::span<const strategy> strategies = all_strategies) -> portfolio_result;
+
+}
@@ -0,0 +1,301 @@
+#include "puzzle_cache.hpp"
+#include "component_count.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <format>
+#include <fstream>
+#include <map>
+#include <print>
+#include <random>
+#include <system_error>
+#include <utility>
+
+namespace sudoku {
+namespace {
+
+constexpr u64 cache_magic = 0x32484341'43505553; // "SUPCACH2", version 1 stored counts only up to 2
+
+// Slot states. A slot goes from empty to claimed when a writer takes it and from claimed
+// to ready once everything in it is written, and never goes back.
+constexpr u32 slot_empty = 0;
+constexpr u32 slot_claimed = 1;
+constexpr u32 slot_ready = 2;
+
+struct file_header
+{
+    u64 magic;
+    u64 slots;
+    u64 cells;
+    u64 stride;
+    u64 used; // slots claimed so far, only ever updated atomically
+    u64 reserved[3];
+};
+
+// The start of each slot, followed by one byte per cell of the solution
+struct slot_header
+{
+    u32 state;
+    u8  has_values;
+    u8  solved;
+    u8  hardest;
+    u8  reserved;
+    u64 key_first;
+    u64 key_second;
+    u64 count;
+    u64 steps;
+};
+
+static_assert(sizeof(file_header) % alignof(slot_header) == 0);
+
+auto stride_for(u64 cells) -> u64
+{
+    return (sizeof(slot_header) + cells + 7) / 8 * 8;
+}
+
+auto bytes_for(u64 slots, u64 cells) -> u64
+{
+    return sizeof(file_header) + slots * stride_for(cells);
+}
+
+// The board's digits under the canonical labelling, which numbers the given digits in the
+// order they first appear and the rest after them in increasing order
+struct canonical_form
+{
+    puzzle_key       key;
+    solution         values;
+    std::vector<i32> original; // by canonical digit, the board's digit
+};
+
+auto canonical_form_of(const sudoku_board& board) -> canonical_form
+{
+    const auto& cells = board.cells();
+    const auto digits = static_cast<i32>(board.digits());
+
+    // Constraints can tell digits apart, so boards with any keep their labels
+    auto relabel = board.constraints.empty();
+    for (const auto& cell : cells) {
+        if (cell.value && (*cell.value < 1 || *cell.value > digits)) relabel = false;
+    }
+
+    auto form = canonical_form{};
+    form.original.resize(digits + 1, 0);
+    auto canonical = std::vector<i32>(digits + 1, 0);
+    auto next = i32{1};
+    if (relabel) {
+        for (const auto& cell : cells) {
+            if (cell.value && canonical[*cell.value] == 0) canonical[*cell.value] = next++;
+        }
+    }
+    for (i32 d = 1; d <= digits; ++d) {
+        if (canonical[d] == 0) canonical[d] = relabel ? next++ : d;
+        form.original[canonical[d]] = d;
+    }
+
+    form.key.add(board.size());
+    form.key.add(board.digits());
+    form.key.add(static_cast<u64>(board.geometry()));
+    for (const auto grid : board.grids()) {
+        form.key.add(static_cast<u64>(grid.x));
+        form.key.add(static_cast<u64>(grid.y));
+    }
+
+    // Regions are numbered in the order they first appear
+    auto regions = std::map<i32, u64>{};
+    form.values = solution(cells.size(), 0);
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        const auto& cell = cells[i];
+        if (cell.value) form.values[i] = relabel ? canonical[*cell.value] : *cell.value;
+        const auto region = cell.region ? regions.try_emplace(*cell.region, regions.size() + 1).first->second : 0;
+        form.key.add(cell.active);
+        form.key.add(region);
+        form.key.add(static_cast<u64>(form.values[i]));
+    }
+
+    for (const auto& c : board.constraints) {
+        form.key.add(c->name());
+        form.key.add(c->clue());
+        const auto positions = c->cells();
+        form.key.add(positions.size());
+        for (const auto pos : positions) {
+            form.key.add(static_cast<u64>(pos.x));
+            form.key.add(static_cast<u64>(pos.y));
+        }
+    }
+    return form;
+}
+
+auto to_original(solution values, const canonical_form& form) -> solution
+{
+    for (auto& value : values) {
+        if (value > 0) value = form.original[value];
+    }
+    return values;
+}
+
+auto read_slot(const std::byte* data, u64 cells, const canonical_form& form) -> puzzle_analysis
+{
+    const auto& header = *reinterpret_cast<const slot_header*>(data);
+    auto analysis = puzzle_analysis{};
+    analysis.count = header.count;
+    analysis.rating = logical_rating{
+        .solved = header.solved != 0,
+        .hardest = static_cast<technique>(header.hardest),
+        .steps = header.steps
+    };
+    if (header.has_values) {
+        const auto digits = data + sizeof(slot_header);
+        auto values = solution(cells);
+        for (u64 i = 0; i != cells; ++i) values[i] = static_cast<i32>(digits[i]);
+        analysis.values = to_original(std::move(values), form);
+    }
+    return analysis;
+}
+
+// Writes a new file and links it into place only if there still isn't one, so processes
+// racing to create the cache all end up opening the same file
+auto create_file(const std::filesystem::path& path, u64 slots, u64 cells) -> bool
+{
+    auto temporary = path;
+    temporary += std::format(".{:x}.tmp", std::random_device{}());
+
+    const auto header = file_header{cache_magic, slots, cells, stride_for(cells), 0, {}};
+    auto file = std::ofstream{temporary, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    auto error = std::error_code{};
+    if (file) std::filesystem::resize_file(temporary, bytes_for(slots, cells), error);
+    if (file && !error) std::filesystem::create_hard_link(temporary, path, error);
+    const auto linked = file && (!error || error == std::errc::file_exists);
+    std::filesystem::remove(temporary, error);
+    return linked;
+}
+
+template <typename T>
+auto atomic(T& value) -> std::atomic_ref<T>
+{
+    return std::atomic_ref<T>{value};
+}
+
+}
+
+auto canonical_key(const sudoku_board& board) -> puzzle_key
+{
+    return canonical_form_of(board).key;
+}
+
+auto puzzle_cache::open(const std::filesystem::path& path, u64 slots, u64 cells) -> std::optional<puzzle_cache>
+{
+    slots = std::bit_ceil(std::max<u64>(slots, 1));
+    if (!std::filesystem::exists(path) && !create_file(path, slots, cells)) {
+        std::print("puzzle_cache failed - could not create {}\n", path.string());
+        return {};
+    }
+
+    auto file = mapped_file::open(path, mapped_file::access::read_write);
+    if (!file) {
+        std::print("puzzle_cache failed - could not map {}\n", path.string());
+        return {};
+    }
+
+    auto cache = puzzle_cache{};
+    cache.d_data = file->data();
+    cache.d_file.emplace(std::move(*file));
+
+    const auto& header = *reinterpret_cast<const file_header*>(cache.d_data);
+    if (cache.d_file->size() < sizeof(file_header) || header.magic != cache_magic || !std::has_single_bit(header.slots)
+        || header.stride != stride_for(header.cells) || cache.d_file->size() < bytes_for(header.slots, header.cells)) {
+        std::print("puzzle_cache failed - {} is not a puzzle cache\n", path.string());
+        return {};
+    }
+    cache.d_slots = header.slots;
+    cache.d_cells = header.cells;
+    cache.d_stride = header.stride;
+    return cache;
+}
+
+auto puzzle_cache::slot(u64 index) const -> std::byte*
+{
+    return d_data + sizeof(file_header) + index * d_stride;
+}
+
+auto puzzle_cache::find_key(const puzzle_key& key) const -> std::byte*
+{
+    for (u64 probe = 0; probe != d_slots; ++probe) {
+        const auto data = slot((key.first + probe) & (d_slots - 1));
+        auto& header = *reinterpret_cast<slot_header*>(data);
+        const auto state = atomic(header.state).load(std::memory_order_acquire);
+        if (state == slot_empty) return nullptr;
+        if (state == slot_ready && header.key_first == key.first && header.key_second == key.second) return data;
+    }
+    return nullptr;
+}
+
+auto puzzle_cache::store(const puzzle_key& key, const puzzle_analysis& analysis) -> bool
+{
+    if (analysis.values && analysis.values->size() > d_cells) return false;
+    auto& used = reinterpret_cast<file_header*>(d_data)->used;
+    if (atomic(used).load(std::memory_order_relaxed) >= d_slots / 4 * 3) return false;
+
+    for (u64 probe = 0; probe != d_slots; ++probe) {
+        const auto data = slot((key.first + probe) & (d_slots - 1));
+        auto& header = *reinterpret_cast<slot_header*>(data);
+        auto state = atomic(header.state).load(std::memory_order_acquire);
+        if (state == slot_ready && header.key_first == key.first && header.key_second == key.second) return true;
+        if (state != slot_empty || !atomic(header.state).compare_exchange_strong(state, slot_claimed, std::memory_order_acquire)) continue;
+
+        atomic(used).fetch_add(1, std::memory_order_relaxed);
+        header.has_values = analysis.values.has_value();
+        header.solved = analysis.rating.solved;
+        header.hardest = static_cast<u8>(analysis.rating.hardest);
+        header.key_first = key.first;
+        header.key_second = key.second;
+        header.count = analysis.count;
+        header.steps = analysis.rating.steps;
+        if (analysis.values) {
+            const auto digits = data + sizeof(slot_header);
+            for (std::size_t i = 0; i != analysis.values->size(); ++i) digits[i] = static_cast<std::byte>((*analysis.values)[i]);
+        }
+        atomic(header.state).store(slot_ready, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+auto puzzle_cache::find(const sudoku_board& board) const -> std::optional<puzzle_analysis>
+{
+    if (board.cells().size() > d_cells) return {};
+    const auto form = canonical_form_of(board);
+    const auto data = find_key(form.key);
+    if (!data) return {};
+    return read_slot(data, board.cells().size(), form);
+}
+
+auto puzzle_cache::analyse(const sudoku_board& board) -> puzzle_analysis
+{
+    const auto fits = board.cells().size() <= d_cells;
+    const auto form = canonical_form_of(board);
+    if (const auto data = fits ? find_key(form.key) : nullptr) return read_slot(data, board.cells().size(), form);
+
+    // The analysis runs on the canonical board, so every labelling of a puzzle gets the
+    // rating that is stored for it
+    const auto canonical = board.with_values(form.values);
+    auto analysis = puzzle_analysis{
+        .values = solve(canonical),
+        .count = count_by_components(canonical),
+        .rating = rate_puzzle(canonical)
+    };
+    if (fits) store(form.key, analysis);
+
+    if (analysis.values) analysis.values = to_original(std::move(*analysis.values), form);
+    return analysis;
+}
+
+auto puzzle_cache::size() const -> u64
+{
+    return atomic(reinterpret_cast<file_header*>(d_data)->used).load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "common.hpp"
+#include "hash128.hpp"
+#include "sudoku.hpp"
+#include "solver.hpp"
+#include "logical_solver.hpp"
+#include "mapped_file.hpp"
+
+#include <filesystem>
+#include <optional>
+
+namespace sudoku {
+
+struct puzzle_analysis
+{
+    std::optional<solution> values;    // the first solution, if there is one
+    u64                     count = 0; // every solution, saturating at u64_max
+    logical_rating          rating;
+};
+
+// Identifies a puzzle whatever its region labels, and for puzzles without constraints,
+// whatever its digit labels, since relabelling the digits doesn't change how it solves
+using puzzle_key = hash128;
+
+auto canonical_key(const sudoku_board& board) -> puzzle_key;
+
+// Analyses of puzzles kept in a file that any number of processes can map at once, so a
+// puzzle seen by an earlier run is a lookup rather than a solve. The file is a fixed size
+// open-addressing table keyed by canonical_key. Entries are only ever added: a writer
+// claims an empty slot with a compare-and-swap, fills it in and then marks it ready, and
+// readers pass over slots that aren't ready, so neither side takes a lock. Once the table
+// is three quarters full new analyses are returned but no longer stored.
+class puzzle_cache
+{
+    std::optional<mapped_file> d_file;
+    std::byte*                 d_data = nullptr; // the start of the file
+    u64                        d_slots = 0;
+    u64                        d_cells = 0; // cells per stored solution
+    u64                        d_stride = 0;
+
+    puzzle_cache() = default;
+
+    auto slot(u64 index) const -> std::byte*;
+    auto find_key(const puzzle_key& key) const -> std::byte*;
+    auto store(const puzzle_key& key, const puzzle_analysis& analysis) -> bool;
+
+public:
+    // Maps the file, creating it with room for the given number of slots, each holding a
+    // solution of up to cells cells, if it doesn't exist yet. An existing file keeps its
+    // own sizes. Prints the problem and returns nothing on failure, which includes every
+    // platform mapped_file can't map writable files on.
+    static auto open(const std::filesystem::path& path, u64 slots = 1 << 16, u64 cells = 81) -> std::optional<puzzle_cache>;
+
+    puzzle_cache(puzzle_cache&&) noexcept = default;
+    puzzle_cache& operator=(puzzle_cache&&) = delete;
+
+    auto find(const sudoku_board& board) const -> std::optional<puzzle_analysis>;
+
+    // Looks the puzzle up, or solves, counts and rates it and stores the result. Puzzles
+    // with more cells than the file was made for are analysed but not stored.
+    auto analyse(const sudoku_board& board) -> puzzle_analysis;
+
+    auto size() const -> u64;
+    auto capacity() const -> u64 { return d_slots; }
+};
+
+}
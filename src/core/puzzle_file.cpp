@@ -0,0 +1,123 @@
+#include "puzzle_file.hpp"
+#include "custom_rule.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+auto parse_geometry(std::string_view name) -> std::optional<geometry>
+{
+    if (name == "diagonal") return diagonal;
+    if (name == "anti_knight") return anti_knight;
+    if (name == "anti_king") return anti_king;
+    if (name == "disjoint_groups") return disjoint_groups;
+    if (name == "windoku") return windoku;
+    return {};
+}
+
+struct grid_list
+{
+    u64                     digits = 9;
+    std::vector<glm::ivec2> grids;
+};
+
+// Reads the "grid <digits> <x> <y>" lines of a multi-grid puzzle, or "samurai" for the
+// usual five 9x9 grids
+auto parse_grids(const std::vector<std::string>& lines) -> std::optional<grid_list>
+{
+    if (lines.size() == 1 && lines[0] == "samurai") return grid_list{9, samurai_grids()};
+    auto list = grid_list{};
+    for (std::size_t i = 0; i != lines.size(); ++i) {
+        auto digits = 0;
+        auto grid = glm::ivec2{};
+        if (std::sscanf(lines[i].c_str(), "grid %d %d %d", &digits, &grid.x, &grid.y) != 3 || digits <= 0) {
+            std::print("load_puzzle failed - '{}' is not a grid\n", lines[i]);
+            return {};
+        }
+        if (i != 0 && static_cast<u64>(digits) != list.digits) {
+            std::print("load_puzzle failed - every grid must be the same size\n");
+            return {};
+        }
+        list.digits = static_cast<u64>(digits);
+        list.grids.push_back(grid);
+    }
+    return list;
+}
+
+}
+
+auto load_puzzle(const std::filesystem::path& path) -> std::optional<sudoku_board>
+{
+    auto file = std::ifstream{path};
+    if (!file) {
+        std::print("load_puzzle failed - could not open {}\n", path.string());
+        return {};
+    }
+
+    auto blocks = std::vector<std::vector<std::string>>(1);
+    auto line = std::string{};
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.starts_with('#')) continue;
+        if (line.empty()) {
+            if (!blocks.back().empty()) blocks.emplace_back();
+            continue;
+        }
+        blocks.back().push_back(line);
+    }
+    if (blocks.back().empty()) blocks.pop_back();
+
+    if (blocks.size() != 2 && blocks.size() != 3) {
+        std::print("load_puzzle failed - expected cells and regions in {}\n", path.string());
+        return {};
+    }
+
+    const auto& cells = blocks[0];
+    const auto multi_grid = blocks[1][0] == "samurai" || blocks[1][0].starts_with("grid ");
+    if (multi_grid) {
+        if (blocks.size() == 3) {
+            std::print("load_puzzle failed - multi-grid puzzles take no geometry or custom rules\n");
+            return {};
+        }
+        const auto list = parse_grids(blocks[1]);
+        if (!list) return {};
+        return sudoku_board::make_multi_board(std::vector<std::string_view>(cells.begin(), cells.end()), list->digits, list->grids);
+    }
+
+    // Custom rules are compiled against the width of the board, and added once it is made
+    auto custom = std::vector<std::shared_ptr<constraint>>{};
+    auto rules = 0;
+    if (blocks.size() == 3) {
+        for (const auto& name : blocks[2]) {
+            if (name.starts_with("rule ")) {
+                auto compiled = custom_rule::compile(std::string_view{name}.substr(5), cells.size());
+                if (!compiled) return {};
+                custom.push_back(std::make_shared<custom_rule>(std::move(*compiled)));
+                continue;
+            }
+            const auto rule = parse_geometry(name);
+            if (!rule) {
+                std::print("load_puzzle failed - '{}' is not a geometry rule\n", name);
+                return {};
+            }
+            rules |= *rule;
+        }
+    }
+
+    const auto& regions = blocks[1];
+    auto board = sudoku_board::make_board(
+        std::vector<std::string_view>(cells.begin(), cells.end()),
+        std::vector<std::string_view>(regions.begin(), regions.end()),
+        rules
+    );
+    board.constraints = std::move(custom);
+    return board;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "sudoku.hpp"
+
+#include <filesystem>
+#include <optional>
+
+namespace sudoku {
+
+// A puzzle file holds the rows of digits ('.' for an empty cell), a blank line and then
+// the rows of regions, the same strings make_board takes. An optional third block names
+// geometry rules, one per line: diagonal, anti_knight, anti_king, disjoint_groups or
+// windoku. The same block may hold "rule <source>" lines, each a custom_rule in the
+// language described in custom_rule.hpp. Lines starting with '#' are comments.
+//
+// A multi-grid puzzle replaces the regions with one "grid <digits> <x> <y>" line per grid,
+// or just "samurai", and writes ' ' for the cells outside every grid. Its regions are the
+// boxes of the grids.
+auto load_puzzle(const std::filesystem::path& path) -> std::optional<sudoku_board>;
+
+}
@@ -0,0 +1,129 @@
+#include "rng.hpp"
+
+#include <atomic>
+#include <bit>
+
+namespace sudoku {
+namespace {
+
+std::atomic<u64> g_seed = 0;
+std::atomic<u64> g_next_stream = 0;
+std::atomic<u64> g_generation = 0; // bumped by seed_random
+
+struct thread_stream
+{
+    rng  gen{0};
+    u64  index = 0;
+    u64  generation = u64_max; // of the seed gen was made from
+    bool numbered = false; // has an index
+    bool assigned = false; // the index came from seed_thread rather than g_next_stream
+};
+
+thread_local auto t_stream = thread_stream{};
+
+// Expands a single seed into a well mixed state, as recommended by the xoshiro authors
+auto splitmix64(u64& x) -> u64
+{
+    auto z = (x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// The index-th stream handed out in turn, which seed_thread's streams can't reach
+auto numbered_stream(u64 seed, u64 index) -> rng
+{
+    auto gen = rng{seed};
+    gen.long_jump();
+    for (u64 i = 0; i != index; ++i) gen.jump();
+    return gen;
+}
+
+}
+
+rng::rng(u64 seed)
+{
+    for (auto& word : d_state) word = splitmix64(seed);
+}
+
+auto rng::stream(u64 seed, u64 index) -> rng
+{
+    auto gen = rng{seed};
+    for (u64 i = 0; i != index; ++i) gen.jump();
+    return gen;
+}
+
+auto rng::operator()() -> result_type
+{
+    const auto result = std::rotl(d_state[1] * 5, 7) * 9;
+    const auto t = d_state[1] << 17;
+
+    d_state[2] ^= d_state[0];
+    d_state[3] ^= d_state[1];
+    d_state[1] ^= d_state[2];
+    d_state[0] ^= d_state[3];
+
+    d_state[2] ^= t;
+    d_state[3] = std::rotl(d_state[3], 45);
+
+    return result;
+}
+
+auto rng::jump() -> void
+{
+    jump_by({0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c});
+}
+
+auto rng::long_jump() -> void
+{
+    jump_by({0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbd27b});
+}
+
+auto rng::jump_by(const std::array<u64, 4>& polynomial) -> void
+{
+    auto next = std::array<u64, 4>{};
+    for (const auto word : polynomial) {
+        for (u64 bit = 0; bit != 64; ++bit) {
+            if (word & (u64{1} << bit)) {
+                for (std::size_t i = 0; i != next.size(); ++i) next[i] ^= d_state[i];
+            }
+            (*this)();
+        }
+    }
+    d_state = next;
+}
+
+auto thread_rng() -> rng&
+{
+    auto& stream = t_stream;
+    const auto generation = g_generation.load(std::memory_order_acquire);
+    if (stream.generation != generation) {
+        if (!stream.numbered) {
+            stream.index = g_next_stream.fetch_add(1);
+            stream.numbered = true;
+        }
+        stream.gen = stream.assigned ? rng::stream(g_seed.load(), stream.index) : numbered_stream(g_seed.load(), stream.index);
+        stream.generation = generation;
+    }
+    return stream.gen;
+}
+
+auto seed_random(u64 seed) -> void
+{
+    g_seed = seed;
+    g_next_stream = 0;
+    g_generation.fetch_add(1, std::memory_order_release);
+    seed_thread(0);
+}
+
+auto seed_thread(u64 index) -> void
+{
+    auto& stream = t_stream;
+    stream.generation = g_generation.load(std::memory_order_acquire);
+    stream.index = index;
+    stream.numbered = true;
+    stream.assigned = true;
+    stream.gen = rng::stream(g_seed.load(), index);
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "common.hpp"
+
+#include <array>
+
+namespace sudoku {
+
+// xoshiro256**, a small and fast generator whose jump() skips ahead 2^128 draws, so a
+// single seed can be split into non-overlapping streams for parallel work. Satisfies
+// UniformRandomBitGenerator so it works with the <random> distributions.
+class rng
+{
+    std::array<u64, 4> d_state;
+
+    auto jump_by(const std::array<u64, 4>& polynomial) -> void;
+
+public:
+    using result_type = u64;
+
+    explicit rng(u64 seed);
+
+    // The index-th independent stream derived from seed
+    static auto stream(u64 seed, u64 index) -> rng;
+
+    static constexpr auto min() -> result_type { return 0; }
+    static constexpr auto max() -> result_type { return u64_max; }
+
+    auto operator()() -> result_type;
+    auto jump() -> void;
+    auto long_jump() -> void; // skips 2^192 draws, as far as 2^64 jumps
+};
+
+// The generator used by the random_* helpers on the calling thread, a stream of the global
+// seed. Threads that want the same draws on every run give themselves a stream with
+// seed_thread, others are numbered in the order they first draw. Numbered streams start a
+// long jump past the seed, beyond every stream seed_thread can pick, so the two never meet.
+auto thread_rng() -> rng&;
+
+// Sets the global seed and makes the calling thread stream 0 of it. Every other thread
+// moves to its stream of the new seed on its next draw.
+auto seed_random(u64 seed) -> void;
+
+// Puts the calling thread on the index-th stream of the global seed, which it keeps when
+// the seed changes. Workers pass their own id, counting from 1 as 0 is the seeding thread's.
+auto seed_thread(u64 index) -> void;
+
+}
@@ -0,0 +1,182 @@
+#include "solution_validator.hpp"
+#include "mapped_file.hpp"
+#include "solver.hpp"
+
+#include <algorithm>
+#include <array>
+#include <print>
+
+namespace sudoku {
+namespace {
+
+// Digits are stored cell-major with one mask per lane, as in the batch solver, so every
+// check is a fixed-length loop over contiguous masks that the compiler turns into vector
+// code. Lane flags are all ones for true.
+using lane_masks = std::array<digit_mask, validator_lanes>;
+
+auto to_flag(bool value) -> digit_mask
+{
+    return value ? ~digit_mask{0} : 0;
+}
+
+class lane_validator
+{
+    const sudoku_board&                d_layout;
+    std::vector<u16>                   d_active; // the active cells in reading order
+    std::vector<std::pair<u16, u16>>   d_pairs;  // peers that share no house, from the geometry
+    std::array<digit_mask, 256>        d_bit_of; // per symbol, its digit's bit or 0 if it isn't one
+    std::vector<lane_masks>            d_digits; // per cell
+    lane_masks                         d_failed = {};
+
+    auto load(std::span<const std::string_view> grids) -> void
+    {
+        d_failed = {};
+        for (u64 lane = 0; lane != validator_lanes; ++lane) {
+            if (lane >= grids.size() || grids[lane].size() != d_active.size()) {
+                d_failed[lane] = to_flag(true);
+                for (const auto cell : d_active) d_digits[cell][lane] = 0;
+                continue;
+            }
+            const auto grid = grids[lane];
+            auto missing = digit_mask{0};
+            for (std::size_t i = 0; i != d_active.size(); ++i) {
+                const auto bit = d_bit_of[static_cast<u8>(grid[i])];
+                missing |= to_flag(bit == 0);
+                d_digits[d_active[i]][lane] = bit;
+            }
+            d_failed[lane] = missing;
+        }
+    }
+
+    // A house holds each digit at most once, and every cell holds a digit, so no bit may
+    // turn up twice while or-ing the house together
+    auto check_houses() -> void
+    {
+        for (const auto& house : d_layout.houses()) {
+            auto once = lane_masks{};
+            auto twice = lane_masks{};
+            for (const auto cell : house) {
+                const auto& digits = d_digits[cell];
+                for (u64 lane = 0; lane != validator_lanes; ++lane) {
+                    twice[lane] |= once[lane] & digits[lane];
+                    once[lane] |= digits[lane];
+                }
+            }
+            for (u64 lane = 0; lane != validator_lanes; ++lane) d_failed[lane] |= to_flag(twice[lane] != 0);
+        }
+    }
+
+    auto check_pairs() -> void
+    {
+        for (const auto& [a, b] : d_pairs) {
+            const auto& first = d_digits[a];
+            const auto& second = d_digits[b];
+            for (u64 lane = 0; lane != validator_lanes; ++lane) d_failed[lane] |= to_flag(first[lane] == second[lane]);
+        }
+    }
+
+    // Constraints only run on grids that passed everything else
+    auto check_constraints(u64 lane) const -> bool
+    {
+        auto values = solution(d_digits.size(), 0);
+        for (const auto cell : d_active) values[cell] = lowest_digit(d_digits[cell][lane]);
+        const auto board = d_layout.with_values(values);
+        for (const auto& c : d_layout.constraints) {
+            if (!c->check(board)) return false;
+        }
+        return true;
+    }
+
+public:
+    explicit lane_validator(const sudoku_board& layout)
+        : d_layout{layout}
+        , d_bit_of{}
+        , d_digits(layout.cells().size(), lane_masks{})
+    {
+        const auto& cells = layout.cells();
+        for (std::size_t i = 0; i != cells.size(); ++i) {
+            if (cells[i].active) d_active.push_back(static_cast<u16>(i));
+        }
+
+        for (u64 c = 0; c != d_bit_of.size(); ++c) {
+            const auto digit = parse_symbol(static_cast<char>(c));
+            if (digit && 1 <= *digit && *digit <= static_cast<i32>(layout.digits())) d_bit_of[c] = digit_bit(*digit);
+        }
+
+        // Anti-knight and anti-king make peers outside of any house, which are compared
+        // pair by pair
+        if (layout.geometry() & (anti_knight | anti_king)) {
+            auto houses_of = std::vector<std::vector<u64>>(cells.size());
+            for (std::size_t h = 0; h != layout.houses().size(); ++h) {
+                for (const auto cell : layout.houses()[h]) houses_of[cell].push_back(h);
+            }
+            const auto share_house = [&](u16 a, u16 b) {
+                return std::ranges::any_of(houses_of[a], [&](u64 h) { return std::ranges::find(houses_of[b], h) != houses_of[b].end(); });
+            };
+            for (const auto cell : d_active) {
+                for (const auto peer : layout.peers(cell)) {
+                    if (peer > cell && !share_house(cell, peer)) d_pairs.emplace_back(cell, peer);
+                }
+            }
+        }
+    }
+
+    // Checks up to validator_lanes grids, the first of which has index first, and adds the
+    // indices of the invalid ones
+    auto check(std::span<const std::string_view> grids, u64 first, std::vector<u64>& invalid) -> void
+    {
+        load(grids);
+        check_houses();
+        check_pairs();
+        for (u64 lane = 0; lane != grids.size(); ++lane) {
+            if (d_failed[lane] || (!d_layout.constraints.empty() && !check_constraints(lane))) invalid.push_back(first + lane);
+        }
+    }
+};
+
+}
+
+auto validate_grids(const sudoku_board& layout, std::span<const std::string_view> grids) -> std::vector<u64>
+{
+    auto validator = lane_validator{layout};
+    auto invalid = std::vector<u64>{};
+    for (u64 first = 0; first < grids.size(); first += validator_lanes) {
+        validator.check(grids.subspan(first, std::min(validator_lanes, grids.size() - first)), first, invalid);
+    }
+    return invalid;
+}
+
+auto validate_file(const sudoku_board& layout, const std::filesystem::path& path) -> std::optional<validation_report>
+{
+    const auto file = mapped_file::open(path, mapped_file::access::read);
+    if (!file) {
+        std::print("validate_file failed - could not open {}\n", path.string());
+        return {};
+    }
+
+    auto validator = lane_validator{layout};
+    auto report = validation_report{};
+    auto group = std::array<std::string_view, validator_lanes>{};
+    u64 count = 0;
+    const auto flush = [&] {
+        validator.check(std::span{group}.first(count), report.grids, report.invalid);
+        report.grids += count;
+        count = 0;
+    };
+
+    auto rest = file->view();
+    while (!rest.empty()) {
+        const auto end = rest.find('\n');
+        auto line = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+        group[count++] = line;
+        if (count == validator_lanes) flush();
+    }
+    if (count != 0) flush();
+    return report;
+}
+
+}
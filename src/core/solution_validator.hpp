@@ -0,0 +1,32 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sudoku {
+
+// Grids are validated in groups of this many, one per lane
+static constexpr u64 validator_lanes = 16;
+
+// Checks completed grids against the houses, geometry and constraints of the layout, whose
+// own digits are ignored. A grid is one symbol per active cell in reading order, void
+// cells are skipped. Returns the indices of the grids that aren't valid solutions.
+auto validate_grids(const sudoku_board& layout, std::span<const std::string_view> grids) -> std::vector<u64>;
+
+struct validation_report
+{
+    u64              grids = 0;
+    std::vector<u64> invalid; // indices counting only the non-empty lines
+};
+
+// Validates a file of grids, one per line, mapping it into memory where the platform can
+// and reading it front to back so only a group of grids is checked at a time. Prints the
+// problem and returns nothing if the file can't be read.
+auto validate_file(const sudoku_board& layout, const std::filesystem::path& path) -> std::optional<validation_report>;
+
+}
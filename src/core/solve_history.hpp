@@ -1,5 +1,6 @@
 #pragma once
 #include "common.hpp"
+#include "cell_index.hpp"
 
 #include <vector>
 #include <deque>
@@ -7,8 +8,6 @@
 #include <set>
 #include <variant>
 
-#include <glm/glm.hpp>
-
 namespace sudoku {
 
 struct digit_diff
@@ -31,7 +30,7 @@ struct corner_diff
 
 struct diff
 {
-    glm::ivec2                                         pos;
+    cell_index                                         cell;
     std::variant<digit_diff, corner_diff, centre_diff> data;
 };
 
@@ -40,7 +39,7 @@ using edit_event = std::vector<diff>;
 class solve_history
 {
     std::deque<edit_event> d_events;
-    std::size_t            d_curr;
+    std::size_t            d_curr = 0;
 
 public:
     solve_history() = default;
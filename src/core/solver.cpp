@@ -0,0 +1,566 @@
+#include "solver.hpp"
+#include "solver_stats.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace sudoku {
+namespace {
+
+// Decision levels are kept as bit min(level, 63) of a mask, so bit 63 stands for every
+// level from 63 down. Facts that follow from the givens alone have no bits.
+constexpr auto all_levels = ~u64{0};
+
+auto level_bit(u64 depth) -> u64
+{
+    return u64{1} << std::min<u64>(depth, 63);
+}
+
+// The levels behind the eliminations in a cell, or all of them when nothing is tracked
+auto reasons_of(const grid_state& state, u64 cell) -> u64
+{
+    return state.reasons.empty() ? all_levels : state.reasons[cell];
+}
+
+// The levels behind every elimination made so far
+auto all_reasons(const grid_state& state) -> u64
+{
+    if (state.reasons.empty()) return all_levels;
+    auto why = u64{0};
+    for (const auto r : state.reasons) why |= r;
+    return why;
+}
+
+// Sets of decisions, as (cell, digit) literals, that the search has shown can't all hold.
+// There are at most capacity of them, a new one takes the slot of the oldest, and only
+// short ones are kept since long ones rarely come up again.
+class nogood_store
+{
+    static constexpr u64 capacity = 1024;
+    static constexpr u64 max_literals = 8;
+
+    struct nogood
+    {
+        std::array<u32, max_literals> literals = {};
+        u64                           size = 0;
+    };
+
+    std::vector<nogood>           d_nogoods;
+    std::vector<std::vector<u16>> d_containing; // for each literal, the nogoods it is in
+    u64                           d_next = 0;
+    u64                           d_digits = 0;
+
+public:
+    auto reset(u64 cells, u64 digits) -> void
+    {
+        d_nogoods.clear();
+        d_containing.assign(cells * digits, {});
+        d_next = 0;
+        d_digits = digits;
+    }
+
+    auto literal(u64 cell, digit_mask bit) const -> u32
+    {
+        return static_cast<u32>(cell * d_digits + std::countr_zero(bit));
+    }
+
+    auto add(std::span<const u32> literals) -> void
+    {
+        if (literals.empty() || literals.size() > max_literals) return;
+        const auto id = static_cast<u16>(d_next++ % capacity);
+        if (id == d_nogoods.size()) d_nogoods.emplace_back();
+        auto& slot = d_nogoods[id];
+        for (u64 i = 0; i != slot.size; ++i) std::erase(d_containing[slot.literals[i]], id);
+
+        slot.size = literals.size();
+        std::ranges::copy(literals, slot.literals.begin());
+        for (const auto l : literals) d_containing[l].push_back(id);
+    }
+
+    // True if making the literal true would complete a nogood, in which case the levels
+    // that fixed the nogood's other literals are added to conflict
+    auto blocks(const grid_state& state, u32 literal, u64& conflict) const -> bool
+    {
+        for (const auto id : d_containing[literal]) {
+            const auto& ng = d_nogoods[id];
+            auto why = u64{0};
+            auto holds = true;
+            for (u64 i = 0; i != ng.size && holds; ++i) {
+                const auto other = ng.literals[i];
+                if (other == literal) continue;
+                const auto cell = other / d_digits;
+                holds = state.candidates[cell] == digit_bit(static_cast<i32>(other % d_digits) + 1);
+                why |= reasons_of(state, cell);
+            }
+            if (holds) {
+                conflict = why;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+struct search_context
+{
+    const sudoku_board&     board;
+    digit_mask              full;
+    u64                     limit;
+    search_options          options;
+    solver_stats*           stats;
+    u64                     found = 0;
+    std::optional<solution> first;
+
+    // Only used with backjumping: the literal decided at each level of the current branch,
+    // and the nogoods learned so far
+    std::vector<u32>        path;
+    nogood_store            nogoods;
+};
+
+// Tallied in locals by the propagation loops and flushed to the stats once per call, so
+// the hot loops never touch the collector
+struct propagation_counts
+{
+    u64 peer_prunes    = 0;
+    u64 naked_singles  = 0;
+    u64 hidden_singles = 0;
+};
+
+// Removes the digit of each queued cell from its peers, queueing any peer that is left
+// with a single candidate. Returns false if a cell runs out of candidates.
+//
+// With backjumping each removal also passes on the reasons the cell was solved, and a
+// failure sets conflict to the levels it depends on.
+auto eliminate_peers(const sudoku_board& board, grid_state& state, std::vector<u16>& queue, propagation_counts& counts, u64& conflict) -> bool
+{
+    const auto tracking = !state.reasons.empty();
+    while (!queue.empty()) {
+        const auto cell = queue.back();
+        queue.pop_back();
+        if (state.placed[cell]) continue;
+        state.placed[cell] = 1;
+
+        const auto bit = state.candidates[cell];
+        for (const auto peer : board.peers(cell)) {
+            auto& mask = state.candidates[peer];
+            if (!(mask & bit)) continue;
+            mask &= ~bit;
+            if (tracking) state.reasons[peer] |= state.reasons[cell];
+            ++counts.peer_prunes;
+            if (mask == 0) {
+                conflict = reasons_of(state, peer);
+                return false;
+            }
+            if (std::has_single_bit(mask)) {
+                queue.push_back(peer);
+                ++counts.naked_singles;
+            }
+        }
+    }
+    return true;
+}
+
+// Queues every cell that is the only place left in one of its houses for some digit.
+// Returns false if a house can no longer fit all of its digits.
+auto find_hidden_singles(const sudoku_board& board, grid_state& state, digit_mask full, std::vector<u16>& queue, propagation_counts& counts, u64& conflict) -> bool
+{
+    // Whatever happens in a house rests on the eliminations in all of its cells
+    const auto house_reasons = [&](const std::vector<u16>& house) {
+        if (state.reasons.empty()) return all_levels;
+        auto why = u64{0};
+        for (const auto cell : house) why |= state.reasons[cell];
+        return why;
+    };
+
+    for (const auto& house : board.houses()) {
+        digit_mask once = 0;
+        digit_mask twice = 0;
+        for (const auto cell : house) {
+            const auto mask = state.candidates[cell];
+            twice |= once & mask;
+            once |= mask;
+        }
+        if (house.size() == board.digits() && once != full) {
+            conflict = house_reasons(house);
+            return false;
+        }
+
+        const auto hidden = once & ~twice;
+        if (!hidden) continue;
+        for (const auto cell : house) {
+            const auto mask = state.candidates[cell];
+            if (std::has_single_bit(mask) || !(mask & hidden)) continue;
+            if (!std::has_single_bit(mask & hidden)) { // two digits both need this cell
+                conflict = house_reasons(house);
+                return false;
+            }
+            state.candidates[cell] = mask & hidden;
+            if (!state.reasons.empty()) state.reasons[cell] |= house_reasons(house);
+            queue.push_back(cell);
+            ++counts.hidden_singles;
+        }
+    }
+    return true;
+}
+
+// Lets each constraint narrow the candidates, queueing the cells it leaves with a single
+// candidate. Returns the number of candidates removed, or nothing on a contradiction.
+// Constraints don't say why they removed a candidate, so with backjumping what they do is
+// put down to every elimination made before they ran.
+auto propagate_constraints(const search_context& ctx, grid_state& state, std::vector<u16>& queue, u64& conflict) -> std::optional<u64>
+{
+    const auto before = all_reasons(state);
+    u64 total = 0;
+    for (const auto& c : ctx.board.constraints) {
+        const auto removed = c->propagate(state.candidates, ctx.board.size());
+        if (!removed) {
+            conflict = before;
+            return {};
+        }
+        if (*removed == 0) continue;
+        total += *removed;
+        if (ctx.stats) ctx.stats->prunes.add(c->name(), *removed);
+    }
+    if (total == 0) return total;
+    std::ranges::fill(state.reasons, before);
+
+    for (std::size_t i = 0; i != state.candidates.size(); ++i) {
+        if (!state.placed[i] && std::has_single_bit(state.candidates[i])) queue.push_back(static_cast<u16>(i));
+    }
+    return total;
+}
+
+auto propagate_loop(const search_context& ctx, grid_state& state, std::vector<u16>& queue, propagation_counts& counts, u64& conflict) -> bool
+{
+    while (true) {
+        if (!eliminate_peers(ctx.board, state, queue, counts, conflict)) return false;
+        if (!find_hidden_singles(ctx.board, state, ctx.full, queue, counts, conflict)) return false;
+        if (!queue.empty()) continue;
+
+        // Constraints run once the houses have nothing left to give, and go around again
+        // for as long as they keep narrowing
+        const auto removed = propagate_constraints(ctx, state, queue, conflict);
+        if (!removed) return false;
+        if (*removed == 0) return true;
+    }
+}
+
+auto propagate(const search_context& ctx, grid_state& state, std::vector<u16>& queue, u64& conflict) -> bool
+{
+    auto counts = propagation_counts{};
+    const auto result = propagate_loop(ctx, state, queue, counts, conflict);
+    if (ctx.stats) {
+        ++ctx.stats->propagation_calls;
+        ctx.stats->prunes.add("house", counts.peer_prunes);
+        ctx.stats->technique_hits.add("naked_single", counts.naked_singles);
+        ctx.stats->technique_hits.add("hidden_single", counts.hidden_singles);
+    }
+    return result;
+}
+
+auto propagate(const search_context& ctx, grid_state& state, std::vector<u16>& queue) -> bool
+{
+    auto conflict = u64{0};
+    return propagate(ctx, state, queue, conflict);
+}
+
+auto to_solution(const grid_state& state) -> solution
+{
+    auto values = solution(state.candidates.size());
+    for (std::size_t i = 0; i != values.size(); ++i) {
+        values[i] = state.candidates[i] ? lowest_digit(state.candidates[i]) : 0;
+    }
+    return values;
+}
+
+auto satisfies_constraints(const search_context& ctx, const solution& values) -> bool
+{
+    if (ctx.board.constraints.empty()) return true;
+    const auto filled = ctx.board.with_values(values);
+    for (const auto& c : ctx.board.constraints) {
+        if (!c->check(filled)) {
+            if (ctx.stats) ctx.stats->prunes.add(c->name(), 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Searches below a propagated state, returning the levels that the failure of the subtree
+// depends on. A subtree that found a solution or was stopped depends on everything. When
+// that set leaves out this level, trying the other digits here would fail the same way,
+// so the search jumps straight back to the deepest level in it.
+auto search(search_context& ctx, const grid_state& state, u64 depth = 0) -> u64
+{
+    if (ctx.options.stop.stop_requested()) return all_levels;
+    if (ctx.stats) ++ctx.stats->nodes;
+
+    const auto best = branch_cell(state);
+    if (!best) {
+        auto values = to_solution(state);
+        if (!satisfies_constraints(ctx, values)) {
+            if (ctx.stats) ++ctx.stats->backtracks;
+            return all_reasons(state);
+        }
+        if (ctx.found++ == 0) ctx.first = std::move(values);
+        return all_levels;
+    }
+
+    const auto tracking = !state.reasons.empty();
+    const auto level = level_bit(depth);
+    auto conflict = reasons_of(state, *best); // whatever removed the digits not tried here
+
+    auto queue = std::vector<u16>{};
+    for (auto mask = state.candidates[*best]; mask;) {
+        const auto bit = ctx.options.reverse_digits ? std::bit_floor(mask) : lowest_bit(mask);
+        mask &= ~bit;
+
+        auto why = u64{0};
+        if (tracking) {
+            const auto literal = ctx.nogoods.literal(*best, bit);
+            if (ctx.nogoods.blocks(state, literal, why)) {
+                if (ctx.stats) ctx.stats->prunes.add("nogood", 1);
+                conflict |= why | level;
+                continue;
+            }
+            if (depth < ctx.path.size()) ctx.path[depth] = literal;
+        }
+
+        auto next = state;
+        next.candidates[*best] = bit;
+        if (tracking) next.reasons[*best] |= level;
+        queue.assign(1, *best);
+        if (propagate(ctx, next, queue, why)) {
+            why = search(ctx, next, depth + 1);
+            if (ctx.found >= ctx.limit) return all_levels;
+        } else if (ctx.stats) {
+            ++ctx.stats->backtracks;
+        }
+
+        if (tracking && !(why & level)) {
+            if (ctx.stats) ++ctx.stats->backjumps;
+            return why;
+        }
+        conflict |= why;
+    }
+
+    // Every digit failed, so the decisions of the levels above that led here can't all
+    // hold together
+    if (depth < 63) conflict &= ~level;
+    if (tracking && !(conflict & level_bit(63)) && std::popcount(conflict) <= 8) {
+        auto literals = std::array<u32, 8>{};
+        auto size = u64{0};
+        for (auto rest = conflict; rest; rest &= rest - 1) literals[size++] = ctx.path[std::countr_zero(rest)];
+        ctx.nogoods.add(std::span{literals}.first(size));
+    }
+    return conflict;
+}
+
+// Starts reason tracking on a propagated state, whose eliminations all follow from the
+// board's digits
+auto start_backjumping(search_context& ctx, grid_state& state) -> void
+{
+    if (!ctx.options.backjumping) return;
+    state.reasons.assign(state.candidates.size(), 0);
+    ctx.path.assign(63, 0);
+    ctx.nogoods.reset(state.candidates.size(), ctx.board.digits());
+}
+
+auto make_context(const sudoku_board& board, u64 limit, const search_options& options) -> search_context
+{
+    return search_context{
+        .board = board,
+        .full = all_digits(board.digits()),
+        .limit = limit,
+        .options = options,
+        .stats = current_stats()
+    };
+}
+
+// The board's digits with their consequences propagated, or nothing on a contradiction
+auto initial_state_of(const search_context& ctx) -> std::optional<grid_state>
+{
+    const auto& cells = ctx.board.cells();
+    auto state = grid_state{
+        .candidates = std::vector<digit_mask>(cells.size(), ctx.full),
+        .placed = std::vector<u8>(cells.size(), 0)
+    };
+    auto queue = std::vector<u16>{};
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (cells[i].value.has_value()) {
+            state.candidates[i] = digit_bit(*cells[i].value);
+            queue.push_back(static_cast<u16>(i));
+        } else if (!cells[i].active) {
+            // Cells outside every grid hold nothing and are never branched on
+            state.candidates[i] = 0;
+            state.placed[i] = 1;
+        }
+    }
+
+    const auto timer = phase_timer{ctx.stats, "propagation"};
+    if (!propagate(ctx, state, queue)) return {};
+    return state;
+}
+
+auto run_search(const sudoku_board& board, u64 limit, const search_options& options) -> search_context
+{
+    auto ctx = make_context(board, limit, options);
+    if (limit == 0) return ctx;
+
+    auto state = initial_state_of(ctx);
+    if (!state) return ctx;
+
+    start_backjumping(ctx, *state);
+    const auto timer = phase_timer{ctx.stats, "search"};
+    search(ctx, *state);
+    return ctx;
+}
+
+}
+
+auto solve(const sudoku_board& board) -> std::optional<solution>
+{
+    return solve(board, search_options{});
+}
+
+auto solve(const sudoku_board& board, const search_options& options) -> std::optional<solution>
+{
+    return run_search(board, 1, options).first;
+}
+
+auto count_solutions(const sudoku_board& board, u64 limit) -> u64
+{
+    return run_search(board, limit, search_options{}).found;
+}
+
+auto solutions(const sudoku_board& board) -> std::generator<const solution&>
+{
+    // The recursion of search() unrolled onto an explicit stack so the generator can
+    // suspend between solutions. Each frame is one branch point and the digits it has
+    // left to try.
+    struct frame
+    {
+        grid_state state;
+        u16        cell;
+        digit_mask remaining;
+    };
+
+    auto ctx = make_context(board, u64_max, search_options{});
+    auto root = initial_state_of(ctx);
+    if (!root) co_return;
+
+    auto stack = std::vector<frame>{};
+    auto queue = std::vector<u16>{};
+    auto values = solution{};
+
+    // Either pushes a frame to branch on, or reports the state as a leaf
+    const auto enter = [&](grid_state&& state) -> bool {
+        if (ctx.stats) ++ctx.stats->nodes;
+        const auto cell = branch_cell(state);
+        if (cell) {
+            const auto remaining = state.candidates[*cell];
+            stack.push_back(frame{std::move(state), *cell, remaining});
+            return false;
+        }
+        values = to_solution(state);
+        if (satisfies_constraints(ctx, values)) return true;
+        if (ctx.stats) ++ctx.stats->backtracks;
+        return false;
+    };
+
+    if (enter(std::move(*root))) {
+        co_yield values;
+        co_return;
+    }
+
+    while (!stack.empty()) {
+        // The caller may resume from another thread or after its stats scope has ended, so
+        // the collector is looked up again rather than kept from the first resume
+        ctx.stats = current_stats();
+
+        auto& top = stack.back();
+        if (!top.remaining) {
+            stack.pop_back();
+            continue;
+        }
+
+        const auto bit = lowest_bit(top.remaining);
+        top.remaining &= ~bit;
+
+        auto next = top.state;
+        next.candidates[top.cell] = bit;
+        queue.assign(1, top.cell);
+        if (!propagate(ctx, next, queue)) {
+            if (ctx.stats) ++ctx.stats->backtracks;
+            continue;
+        }
+        if (enter(std::move(next))) {
+            co_yield values;
+        }
+    }
+}
+
+auto initial_state(const sudoku_board& board) -> std::optional<grid_state>
+{
+    return initial_state_of(make_context(board, 1, search_options{}));
+}
+
+auto propagate_state(const sudoku_board& board, grid_state& state, std::vector<u16>& queue) -> bool
+{
+    return propagate(make_context(board, 1, search_options{}), state, queue);
+}
+
+auto solve_from(const sudoku_board& board, const grid_state& state, const search_options& options) -> std::optional<solution>
+{
+    auto ctx = make_context(board, 1, options);
+    auto start = state;
+    start_backjumping(ctx, start);
+    const auto timer = phase_timer{ctx.stats, "search"};
+    search(ctx, start);
+    return ctx.first;
+}
+
+auto branch_cell(const grid_state& state) -> std::optional<u16>
+{
+    auto best = std::optional<u16>{};
+    auto best_count = u64_max;
+    for (std::size_t i = 0; i != state.candidates.size(); ++i) {
+        const auto count = static_cast<u64>(std::popcount(state.candidates[i]));
+        if (count > 1 && count < best_count) {
+            best = static_cast<u16>(i);
+            best_count = count;
+            if (count == 2) break;
+        }
+    }
+    return best;
+}
+
+auto is_solved(const sudoku_board& board) -> bool
+{
+    const auto& cells = board.cells();
+    for (const auto& house : board.houses()) {
+        digit_mask seen = 0;
+        for (const auto cell : house) {
+            const auto value = cells[cell].value;
+            if (!value.has_value()) return false;
+            const auto bit = digit_bit(*value);
+            if (seen & bit) return false;
+            seen |= bit;
+        }
+    }
+    // Anti-knight and anti-king make peers outside of any house
+    if (board.geometry() & (anti_knight | anti_king)) {
+        for (std::size_t i = 0; i != cells.size(); ++i) {
+            for (const auto peer : board.peers(i)) {
+                if (cells[peer].value == cells[i].value) return false;
+            }
+        }
+    }
+    for (const auto& c : board.constraints) {
+        if (!c->check(board)) return false;
+    }
+    return true;
+}
+
+}
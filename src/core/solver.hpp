@@ -0,0 +1,88 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+
+#include <bit>
+#include <generator>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+namespace sudoku {
+
+// The candidates of a cell, bit (d - 1) is set if the digit d is still possible. 64 bits
+// leaves room for every board size make_board can parse.
+using digit_mask = u64;
+
+constexpr auto digit_bit(i32 digit) -> digit_mask
+{
+    return digit_mask{1} << (digit - 1);
+}
+
+constexpr auto all_digits(u64 size) -> digit_mask
+{
+    return size >= 64 ? ~digit_mask{0} : (digit_mask{1} << size) - 1;
+}
+
+constexpr auto lowest_digit(digit_mask mask) -> i32
+{
+    return std::countr_zero(mask) + 1;
+}
+
+constexpr auto lowest_bit(digit_mask mask) -> digit_mask
+{
+    return mask & (~mask + 1);
+}
+
+// The digits of a completed grid, indexed by x + y * size. Cells outside every grid of a
+// multi-grid board are 0.
+using solution = std::vector<i32>;
+
+// A candidate mask per cell, and for each cell whether its digit has been removed from its
+// peers yet. This is what the search copies at every branch. When backjumping, reasons
+// holds for each cell the decision levels its eliminations rest on, one bit per level
+// with the last bit covering every level past it; it is empty otherwise.
+struct grid_state
+{
+    std::vector<digit_mask> candidates;
+    std::vector<u8>         placed;
+    std::vector<u64>        reasons;
+};
+
+struct search_options
+{
+    std::stop_token stop           = {};    // the search gives up once a stop is requested
+    bool            reverse_digits = false; // try the largest digits first when guessing
+    bool            backjumping    = false; // jump back past decisions that played no part in a failure
+};
+
+// Every digit currently on the board is treated as a given.
+auto solve(const sudoku_board& board) -> std::optional<solution>;
+auto solve(const sudoku_board& board, const search_options& options) -> std::optional<solution>;
+
+// Stops counting once limit solutions have been found, so a limit of 2 is a uniqueness check.
+auto count_solutions(const sudoku_board& board, u64 limit = u64_max) -> u64;
+
+// Lazily yields every solution, searching only as far as the caller pulls. The reference
+// is valid until the next solution is requested, and the board must outlive the generator.
+// Each resume records to the stats collector of the thread resuming it.
+auto solutions(const sudoku_board& board) -> std::generator<const solution&>;
+
+// The state with the board's digits placed and propagated, or nothing on a contradiction
+auto initial_state(const sudoku_board& board) -> std::optional<grid_state>;
+
+// Propagates the consequences of the queued cells, which must each be down to a single
+// candidate. Returns false on a contradiction, leaving the state part way through.
+auto propagate_state(const sudoku_board& board, grid_state& state, std::vector<u16>& queue) -> bool;
+
+// The cell with the fewest candidates left, which the search branches on next, or nothing
+// if every cell is solved
+auto branch_cell(const grid_state& state) -> std::optional<u16>;
+
+// Searches on from a propagated state rather than from the board's digits
+auto solve_from(const sudoku_board& board, const grid_state& state, const search_options& options = {}) -> std::optional<solution>;
+
+// True if every cell is filled, no house repeats a digit and every constraint holds
+auto is_solved(const sudoku_board& board) -> bool;
+
+}
@@ -0,0 +1,80 @@
+#include "solver_stats.hpp"
+
+#include <format>
+#include <iterator>
+
+namespace sudoku {
+namespace {
+
+thread_local solver_stats* t_current_stats = nullptr;
+
+template <typename T>
+auto append_table(std::string& out, std::string_view name, const stat_table<T>& table) -> void
+{
+    std::format_to(std::back_inserter(out), ",\n  \"{}\": {{", name);
+    bool first = true;
+    for (const auto& [key, value] : table) {
+        std::format_to(std::back_inserter(out), "{}\n    \"{}\": {}", first ? "" : ",", key, value);
+        first = false;
+    }
+    out.append(first ? "}" : "\n  }");
+}
+
+}
+
+auto solver_stats::operator+=(const solver_stats& other) -> solver_stats&
+{
+    nodes += other.nodes;
+    backtracks += other.backtracks;
+    backjumps += other.backjumps;
+    propagation_calls += other.propagation_calls;
+    prunes.merge(other.prunes);
+    technique_hits.merge(other.technique_hits);
+    phase_ms.merge(other.phase_ms);
+    return *this;
+}
+
+auto solver_stats::to_json() const -> std::string
+{
+    auto out = std::format(
+        "{{\n  \"nodes\": {},\n  \"backtracks\": {},\n  \"backjumps\": {},\n  \"propagation_calls\": {}",
+        nodes, backtracks, backjumps, propagation_calls
+    );
+    append_table(out, "prunes", prunes);
+    append_table(out, "technique_hits", technique_hits);
+    append_table(out, "phase_ms", phase_ms);
+    out.append("\n}\n");
+    return out;
+}
+
+auto current_stats() -> solver_stats*
+{
+    return t_current_stats;
+}
+
+stats_scope::stats_scope(solver_stats& stats)
+    : d_previous{t_current_stats}
+{
+    t_current_stats = &stats;
+}
+
+stats_scope::~stats_scope()
+{
+    t_current_stats = d_previous;
+}
+
+phase_timer::phase_timer(solver_stats* stats, std::string_view phase)
+    : d_stats{stats}
+    , d_phase{phase}
+    , d_start{stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}
+{
+}
+
+phase_timer::~phase_timer()
+{
+    if (!d_stats) return;
+    const auto elapsed = std::chrono::steady_clock::now() - d_start;
+    d_stats->phase_ms.add(d_phase, std::chrono::duration<f64, std::milli>(elapsed).count());
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "common.hpp"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sudoku {
+
+// A few values keyed by name. Names must be string literals, and there are only ever a
+// handful of them, so a flat list beats a map.
+template <typename T>
+class stat_table
+{
+    std::vector<std::pair<std::string_view, T>> d_values;
+
+public:
+    auto add(std::string_view name, T amount) -> void
+    {
+        for (auto& [key, value] : d_values) {
+            if (key == name) {
+                value += amount;
+                return;
+            }
+        }
+        d_values.emplace_back(name, amount);
+    }
+
+    auto get(std::string_view name) const -> T
+    {
+        for (const auto& [key, value] : d_values) {
+            if (key == name) return value;
+        }
+        return T{};
+    }
+
+    auto merge(const stat_table& other) -> void
+    {
+        for (const auto& [key, value] : other.d_values) add(key, value);
+    }
+
+    auto begin() const { return d_values.begin(); }
+    auto end() const { return d_values.end(); }
+};
+
+// Counters filled in by the solvers while a collector is installed on the calling thread.
+// Each thread collects into its own instance, merge them with += once the run is over.
+struct solver_stats
+{
+    u64 nodes             = 0; // search nodes visited
+    u64 backtracks        = 0; // branches that ended in a contradiction
+    u64 backjumps         = 0; // branch points left early because their conflict lay higher up
+    u64 propagation_calls = 0;
+
+    stat_table<u64> prunes;         // candidates removed, by constraint type
+    stat_table<u64> technique_hits; // deductions made, by technique
+    stat_table<f64> phase_ms;       // wall time, by solver phase
+
+    auto operator+=(const solver_stats& other) -> solver_stats&;
+    auto to_json() const -> std::string;
+};
+
+// Returns the collector for the current thread, or nullptr when stats are disabled
+auto current_stats() -> solver_stats*;
+
+// Installs a collector for the current thread for the lifetime of the scope
+class stats_scope
+{
+    solver_stats* d_previous;
+
+    stats_scope(const stats_scope&) = delete;
+    stats_scope& operator=(const stats_scope&) = delete;
+
+public:
+    explicit stats_scope(solver_stats& stats);
+    ~stats_scope();
+};
+
+// Adds the time until destruction to the given phase, does nothing when stats is nullptr
+class phase_timer
+{
+    solver_stats*                         d_stats;
+    std::string_view                      d_phase;
+    std::chrono::steady_clock::time_point d_start;
+
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+
+public:
+    phase_timer(solver_stats* stats, std::string_view phase);
+    ~phase_timer();
+};
+
+}
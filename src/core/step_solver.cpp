@@ -0,0 +1,263 @@
+#include "step_solver.hpp"
+#include "solver.hpp"
+#include "utility.hpp"
+
+#include <set>
+#include <vector>
+
+namespace sudoku {
+namespace {
+
+struct step_state
+{
+    std::vector<digit_mask> candidates;
+    std::vector<u8>         shown;  // the cell's digit is on the board
+    std::vector<u8>         placed; // the cell's digit has been removed from all of its peers
+};
+
+// A guess, with the state to return to and the digits still to try
+struct branch_frame
+{
+    step_state  state;
+    std::size_t trail_size;
+    u16         cell;
+    digit_mask  remaining;
+};
+
+enum class step_kind
+{
+    edit,
+    contradiction,
+    stuck,
+    solved,
+};
+
+struct step_result
+{
+    step_kind kind;
+    diff      edit = {};
+};
+
+auto to_set(digit_mask mask) -> std::set<i32>
+{
+    auto values = std::set<i32>{};
+    for (; mask; mask &= mask - 1) values.insert(lowest_digit(mask));
+    return values;
+}
+
+auto invert(const diff& d) -> diff
+{
+    auto inverted = diff{ .cell = d.cell };
+    std::visit(overloaded{
+        [&](const digit_diff& data) {
+            inverted.data = digit_diff{ .old_value = data.new_value, .new_value = data.old_value };
+        },
+        [&](const centre_diff& data) {
+            inverted.data = centre_diff{ .added = !data.added, .values = data.values };
+        },
+        [&](const corner_diff& data) {
+            inverted.data = corner_diff{ .added = !data.added, .values = data.values };
+        }
+    }, d.data);
+    return inverted;
+}
+
+// Finds the next single visible edit and applies it to the state. Solved cells are shown
+// and then removed from their peers one peer at a time, then hidden singles are looked for.
+auto next_step(const sudoku_board& board, step_state& state, digit_mask full) -> step_result
+{
+    auto all_placed = true;
+
+    for (u64 i = 0; i != state.candidates.size(); ++i) {
+        const auto mask = state.candidates[i];
+        if (!board.cells()[i].active) continue;
+        if (mask == 0) return {step_kind::contradiction};
+        if (state.placed[i]) continue;
+        if (!std::has_single_bit(mask)) {
+            all_placed = false;
+            continue;
+        }
+
+        if (!state.shown[i]) {
+            state.shown[i] = 1;
+            return {step_kind::edit, diff{
+                .cell = cell_index{i},
+                .data = digit_diff{ .old_value = {}, .new_value = lowest_digit(mask) }
+            }};
+        }
+        for (const auto peer : board.peers(i)) {
+            if (state.candidates[peer] & mask) {
+                state.candidates[peer] &= ~mask;
+                return {step_kind::edit, diff{
+                    .cell = cell_index{peer},
+                    .data = centre_diff{ .added = false, .values = {lowest_digit(mask)} }
+                }};
+            }
+        }
+        state.placed[i] = 1;
+    }
+
+    if (all_placed) return {step_kind::solved};
+
+    for (const auto& house : board.houses()) {
+        digit_mask once = 0;
+        digit_mask twice = 0;
+        for (const auto cell : house) {
+            twice |= once & state.candidates[cell];
+            once |= state.candidates[cell];
+        }
+        if (house.size() == board.digits() && once != full) return {step_kind::contradiction};
+
+        const auto hidden = once & ~twice;
+        for (const auto cell : house) {
+            const auto mask = state.candidates[cell];
+            if (std::has_single_bit(mask) || !(mask & hidden)) continue;
+            const auto keep = lowest_bit(mask & hidden);
+            state.candidates[cell] = keep;
+            return {step_kind::edit, diff{
+                .cell = cell_index{cell},
+                .data = centre_diff{ .added = false, .values = to_set(mask & ~keep) }
+            }};
+        }
+    }
+
+    return {step_kind::stuck};
+}
+
+auto branch_cell(const step_state& state) -> u16
+{
+    auto best = u16{0};
+    auto best_count = u64_max;
+    for (std::size_t i = 0; i != state.candidates.size(); ++i) {
+        const auto count = static_cast<u64>(std::popcount(state.candidates[i]));
+        if (count > 1 && count < best_count) {
+            best = static_cast<u16>(i);
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+auto satisfies_constraints(const sudoku_board& board, const step_state& state) -> bool
+{
+    if (board.constraints.empty()) return true;
+    auto values = solution(state.candidates.size());
+    for (std::size_t i = 0; i != values.size(); ++i) {
+        values[i] = state.candidates[i] ? lowest_digit(state.candidates[i]) : 0;
+    }
+    const auto filled = board.with_values(values);
+    for (const auto& c : board.constraints) {
+        if (!c->check(filled)) return false;
+    }
+    return true;
+}
+
+}
+
+auto solve_steps(sudoku_board board) -> std::generator<const diff&>
+{
+    const auto full = all_digits(board.digits());
+    const auto& cells = board.cells();
+
+    auto state = step_state{
+        .candidates = std::vector<digit_mask>(cells.size(), full),
+        .shown = std::vector<u8>(cells.size(), 0),
+        .placed = std::vector<u8>(cells.size(), 0)
+    };
+    auto step = diff{};
+
+    // Start every empty cell off with all of the digits as centre marks
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (cells[i].value.has_value()) {
+            state.candidates[i] = digit_bit(*cells[i].value);
+            state.shown[i] = 1;
+            continue;
+        }
+        if (!cells[i].active) {
+            state.candidates[i] = 0;
+            state.shown[i] = 1;
+            state.placed[i] = 1;
+            continue;
+        }
+        if (!cells[i].centre_pencil_marks.empty()) {
+            step = diff{ .cell = cell_index{i}, .data = centre_diff{ .added = false, .values = cells[i].centre_pencil_marks } };
+            co_yield step;
+        }
+        step = diff{ .cell = cell_index{i}, .data = centre_diff{ .added = true, .values = to_set(full) } };
+        co_yield step;
+    }
+
+    auto stack = std::vector<branch_frame>{};
+    auto trail = std::vector<diff>{}; // edits made since the first guess, so they can be rewound
+
+    while (true) {
+        auto result = next_step(board, state, full);
+        if (result.kind == step_kind::edit) {
+            if (!stack.empty()) trail.push_back(result.edit);
+            step = std::move(result.edit);
+            co_yield step;
+            continue;
+        }
+
+        if (result.kind == step_kind::solved) {
+            if (satisfies_constraints(board, state)) co_return;
+            result.kind = step_kind::contradiction;
+        }
+
+        if (result.kind == step_kind::stuck) {
+            const auto cell = branch_cell(state);
+            stack.push_back(branch_frame{state, trail.size(), cell, state.candidates[cell]});
+        }
+
+        // Rewind to the most recent guess with digits left to try, and try the next one
+        while (true) {
+            if (stack.empty()) co_return; // no solution
+            auto& top = stack.back();
+            while (trail.size() > top.trail_size) {
+                step = invert(trail.back());
+                trail.pop_back();
+                co_yield step;
+            }
+            state = top.state;
+            if (!top.remaining) {
+                stack.pop_back();
+                continue;
+            }
+
+            const auto bit = lowest_bit(top.remaining);
+            top.remaining &= ~bit;
+            const auto others = state.candidates[top.cell] & ~bit;
+            state.candidates[top.cell] = bit;
+
+            step = diff{ .cell = cell_index{top.cell}, .data = centre_diff{ .added = false, .values = to_set(others) } };
+            trail.push_back(step);
+            co_yield step;
+            break;
+        }
+    }
+}
+
+step_solver::step_solver(const sudoku_board& board)
+    : d_steps{solve_steps(board)}
+{
+}
+
+auto step_solver::advance(sudoku_board& board, u64 budget) -> bool
+{
+    if (!d_next) d_next.emplace(d_steps.begin());
+
+    for (u64 i = 0; i != budget; ++i) {
+        if (*d_next == d_steps.end()) {
+            board.record(d_applied);
+            d_applied.clear();
+            return false;
+        }
+        const auto& step = **d_next;
+        board.apply(step);
+        d_applied.push_back(step);
+        ++*d_next;
+    }
+    return true;
+}
+
+}
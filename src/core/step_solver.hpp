@@ -0,0 +1,35 @@
+#pragma once
+#include "common.hpp"
+#include "sudoku.hpp"
+#include "solve_history.hpp"
+
+#include <generator>
+#include <optional>
+#include <ranges>
+
+namespace sudoku {
+
+// Yields a solve of the board one visible edit at a time: candidates as centre pencil
+// marks, each elimination as the removal of a mark and each placement as a digit. When
+// a guess turns out wrong the edits made since are yielded again inverted, so applying
+// every diff in order always leaves the board matching the solver.
+auto solve_steps(sudoku_board board) -> std::generator<const diff&>;
+
+// Plays solve_steps onto a board a bounded number of steps at a time, so a frame costs the
+// same however hard the puzzle is. The whole solve is recorded as a single undoable edit.
+class step_solver
+{
+    using generator = std::generator<const diff&>;
+
+    generator                                        d_steps;
+    std::optional<std::ranges::iterator_t<generator>> d_next;
+    edit_event                                       d_applied;
+
+public:
+    explicit step_solver(const sudoku_board& board);
+
+    // Applies up to budget steps, returns false once the solve has finished
+    auto advance(sudoku_board& board, u64 budget) -> bool;
+};
+
+}
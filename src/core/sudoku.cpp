@@ -2,12 +2,57 @@
 #include "utility.hpp"
 
 #include <print>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <ranges>
 
 namespace sudoku {
 
+auto parse_symbol(char c) -> std::optional<i32>
+{
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('A' <= c && c <= 'Z') return 10 + (c - 'A');
+    if ('a' <= c && c <= 'z') return 10 + (c - 'a');
+    return {};
+}
+
+auto to_symbol(i32 value) -> char
+{
+    assert(0 <= value && value < 36);
+    if (value < 10) return static_cast<char>('0' + value);
+    return static_cast<char>('A' + (value - 10));
+}
+
+auto samurai_grids() -> std::vector<glm::ivec2>
+{
+    return {{0, 0}, {12, 0}, {6, 6}, {0, 12}, {12, 12}};
+}
+
 sudoku_board::sudoku_board(u64 size)
-    : d_size{size}, d_cells{size * size}
+    : d_size{size}, d_digits{size}, d_cells{size * size}, d_grids{{0, 0}}
+{
+}
+
+namespace {
+
+// The position of every cell index for each board size, so converting needs no division
+auto position_table(u64 size) -> std::span<const glm::ivec2>
 {
+    static const auto tables = [] {
+        auto tables = std::array<std::vector<glm::ivec2>, max_board_size + 1>{};
+        for (u64 width = 1; width <= max_board_size; ++width) {
+            for (u64 i = 0; i != width * width; ++i) {
+                tables[width].emplace_back(static_cast<i32>(i % width), static_cast<i32>(i / width));
+            }
+        }
+        return tables;
+    }();
+    assert(size <= max_board_size);
+    return tables[size];
+}
+
 }
 
 auto sudoku_board::get(glm::ivec2 pos) -> sudoku_cell&
@@ -16,13 +61,17 @@ auto sudoku_board::get(glm::ivec2 pos) -> sudoku_cell&
     return d_cells[pos.x + pos.y * d_size];
 }
 
-auto sudoku_board::for_each_selected(const std::function<void(int, int, sudoku_cell&)>& fn)
+auto sudoku_board::get(cell_index cell) -> sudoku_cell&
 {
-    for (i32 x = 0; x != d_size; ++x) {
-        for (i32 y = 0; y != d_size; ++y) {
-            auto& cell = get({x, y});
-            if (cell.selected && !cell.fixed) fn(x, y, cell);
-        }
+    assert(valid(cell));
+    return d_cells[cell.value()];
+}
+
+auto sudoku_board::for_each_selected(const std::function<void(cell_index, sudoku_cell&)>& fn)
+{
+    for (std::size_t i = 0; i != d_cells.size(); ++i) {
+        auto& cell = d_cells[i];
+        if (cell.selected && !cell.fixed) fn(cell_index{i}, cell);
     }
 }
 
@@ -32,37 +81,88 @@ auto sudoku_board::at(glm::ivec2 pos) const -> const sudoku_cell&
     return d_cells[pos.x + pos.y * d_size];
 }
 
-auto sudoku_board::select(glm::ivec2 pos, bool value) -> void
+auto sudoku_board::at(cell_index cell) const -> const sudoku_cell&
+{
+    assert(valid(cell));
+    return d_cells[cell.value()];
+}
+
+auto sudoku_board::index_of(glm::ivec2 pos) const -> cell_index
 {
     assert(valid(pos));
-    get(pos).selected = value;
+    return cell_index{static_cast<u64>(pos.x + pos.y * d_size)};
+}
+
+auto sudoku_board::position_of(cell_index cell) const -> glm::ivec2
+{
+    assert(valid(cell));
+    return position_table(d_size)[cell.value()];
+}
+
+auto sudoku_board::select(glm::ivec2 pos, bool value) -> void
+{
+    select(index_of(pos), value);
+}
+
+auto sudoku_board::select(cell_index cell, bool value) -> void
+{
+    get(cell).selected = value && get(cell).active;
 }
 
 auto sudoku_board::toggle_selected(glm::ivec2 pos) -> void
 {
-    assert(valid(pos));
-    auto& cell = get(pos);
-    cell.selected = !cell.selected;
+    toggle_selected(index_of(pos));
+}
+
+auto sudoku_board::toggle_selected(cell_index cell) -> void
+{
+    auto& c = get(cell);
+    c.selected = !c.selected && c.active;
 }
 
 auto sudoku_board::set_digit(i32 value) -> void
 {
     auto event = edit_event{};
 
-    for (i32 x = 0; x != d_size; ++x) {
-        for (i32 y = 0; y != d_size; ++y) {
-            auto& cell = get({x, y});
-            if (cell.selected && !cell.fixed) {
-                event.emplace_back(diff{
-                    .pos = {x, y},
-                    .data = digit_diff{ .old_value = cell.value, .new_value = value }
-                });
-                cell.value = value;
-            }
+    for_each_selected([&](cell_index index, sudoku_cell& cell) {
+        event.emplace_back(diff{
+            .cell = index,
+            .data = digit_diff{ .old_value = cell.value, .new_value = value }
+        });
+        cell.value = value;
+        if (d_auto_candidates) remove_peer_marks(index.value(), value, event);
+    });
+
+    d_history.add_event(event);
+}
+
+auto sudoku_board::remove_peer_marks(u64 index, i32 value, edit_event& event) -> void
+{
+    for (const auto peer : d_peers[index]) {
+        auto& cell = d_cells[peer];
+        if (cell.centre_pencil_marks.erase(value)) {
+            event.emplace_back(diff{
+                .cell = cell_index{peer},
+                .data = centre_diff{ .added = false, .values = {value} }
+            });
+        }
+        if (cell.corner_pencil_marks.erase(value)) {
+            event.emplace_back(diff{
+                .cell = cell_index{peer},
+                .data = corner_diff{ .added = false, .values = {value} }
+            });
         }
     }
+}
 
-    d_history.add_event(event);
+auto sudoku_board::set_auto_candidates(bool enabled) -> void
+{
+    d_auto_candidates = enabled;
+}
+
+auto sudoku_board::auto_candidates() const -> bool
+{
+    return d_auto_candidates;
 }
 
 auto sudoku_board::set_corner_pencil_mark(i32 value) -> void
@@ -81,11 +181,11 @@ auto sudoku_board::set_corner_pencil_mark(i32 value) -> void
         }
     }
 
-    for_each_selected([&](int x, int y, sudoku_cell& cell) {
+    for_each_selected([&](cell_index index, sudoku_cell& cell) {
         if (add) {
             if (!cell.corner_pencil_marks.contains(value)) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = corner_diff{ .added = true, .values = {value} }
                 });
                 cell.corner_pencil_marks.insert(value);
@@ -93,7 +193,7 @@ auto sudoku_board::set_corner_pencil_mark(i32 value) -> void
         } else {
             if (cell.corner_pencil_marks.contains(value)) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = corner_diff{ .added = false, .values = {value} }
                 });
                 cell.corner_pencil_marks.erase(value);
@@ -120,11 +220,11 @@ auto sudoku_board::set_centre_pencil_mark(i32 value) -> void
         }
     }
 
-    for_each_selected([&](int x, int y, sudoku_cell& cell) {
+    for_each_selected([&](cell_index index, sudoku_cell& cell) {
         if (add) {
             if (!cell.centre_pencil_marks.contains(value)) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = centre_diff{ .added = true, .values = {value} }
                 });
                 cell.centre_pencil_marks.insert(value);
@@ -132,7 +232,7 @@ auto sudoku_board::set_centre_pencil_mark(i32 value) -> void
         } else {
             if (cell.centre_pencil_marks.contains(value)) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = centre_diff{ .added = false, .values = {value} }
                 });
                 cell.centre_pencil_marks.erase(value);
@@ -160,40 +260,37 @@ void sudoku_board::clear_selected()
     auto event = edit_event{};
     
     const auto find_deletion_kind = [&] {
-        for (i32 x = 0; x != d_size; ++x) {
-            for (i32 y = 0; y != d_size; ++y) {
-                auto& cell = get({x, y});
-                if (cell.value.has_value()) return delete_kind::digit;
-                if (!cell.centre_pencil_marks.empty()) return delete_kind::centre;
-                if (!cell.corner_pencil_marks.empty()) return delete_kind::corner;
-            }
+        for (const auto& cell : d_cells) {
+            if (cell.value.has_value()) return delete_kind::digit;
+            if (!cell.centre_pencil_marks.empty()) return delete_kind::centre;
+            if (!cell.corner_pencil_marks.empty()) return delete_kind::corner;
         }
         return delete_kind::none;
     };
 
     switch (find_deletion_kind()) {
         case delete_kind::digit: {
-            for_each_selected([&](int x, int y, sudoku_cell& cell) {
+            for_each_selected([&](cell_index index, sudoku_cell& cell) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = digit_diff{ .old_value = cell.value, .new_value = {} }
                 });
                 cell.value = std::nullopt;
             });
         } break;
         case delete_kind::centre: {
-            for_each_selected([&](int x, int y, sudoku_cell& cell) {
+            for_each_selected([&](cell_index index, sudoku_cell& cell) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = centre_diff{ .added = false, .values = cell.centre_pencil_marks }
                 });
                 cell.centre_pencil_marks.clear();
             });
         } break;
         case delete_kind::corner: {
-            for_each_selected([&](int x, int y, sudoku_cell& cell) {
+            for_each_selected([&](cell_index index, sudoku_cell& cell) {
                 event.emplace_back(diff{
-                    .pos = {x, y},
+                    .cell = index,
                     .data = corner_diff{ .added = false, .values = cell.corner_pencil_marks }
                 });
                 cell.corner_pencil_marks.clear();
@@ -221,8 +318,9 @@ void sudoku_board::undo()
     const auto event = d_history.go_back();
     if (!event) return;
 
-    for (const auto& diff : *event) {
-        auto& cell = get(diff.pos);
+    // Undo in reverse so that several diffs to the same cell unwind correctly
+    for (const auto& diff : *event | std::views::reverse) {
+        auto& cell = get(diff.cell);
         std::visit(overloaded{
             [&](const digit_diff& diff) {
                 cell.value = diff.old_value;
@@ -243,31 +341,56 @@ void sudoku_board::redo()
     if (!event) return;
 
     for (const auto& diff : *event) {
-        auto& cell = get(diff.pos);
-        std::visit(overloaded{
-            [&](const digit_diff& diff) {
-                cell.value = diff.new_value;
-            },
-            [&](const centre_diff& diff) {
-                update_set(cell.centre_pencil_marks, diff.values, diff.added);
-            },
-            [&](const corner_diff& diff) {
-                update_set(cell.corner_pencil_marks, diff.values, diff.added);
-            }
-        }, diff.data);
+        apply(diff);
     }
 }
 
+void sudoku_board::apply(const diff& d)
+{
+    auto& cell = get(d.cell);
+    std::visit(overloaded{
+        [&](const digit_diff& diff) {
+            cell.value = diff.new_value;
+        },
+        [&](const centre_diff& diff) {
+            update_set(cell.centre_pencil_marks, diff.values, diff.added);
+        },
+        [&](const corner_diff& diff) {
+            update_set(cell.corner_pencil_marks, diff.values, diff.added);
+        }
+    }, d.data);
+}
+
+void sudoku_board::record(const edit_event& event)
+{
+    d_history.add_event(event);
+}
+
 auto sudoku_board::size() const -> u64
 {
     return d_size;
 }
 
+auto sudoku_board::digits() const -> u64
+{
+    return d_digits;
+}
+
+auto sudoku_board::grids() const -> std::span<const glm::ivec2>
+{
+    return d_grids;
+}
+
 auto sudoku_board::valid(glm::ivec2 pos) const -> bool
 {
     return 0 <= pos.x && pos.x < d_size && 0 <= pos.y && pos.y < d_size;
 }
 
+auto sudoku_board::valid(cell_index cell) const -> bool
+{
+    return cell.value() < d_cells.size();
+}
+
 auto sudoku_board::unselect_all() -> void 
 {
     for (auto& cell : d_cells) cell.selected = false;
@@ -278,15 +401,168 @@ auto sudoku_board::cells() const -> const std::vector<sudoku_cell>&
     return d_cells;
 }
 
-auto sudoku_board::make_board(std::vector<std::string_view> cells, std::vector<std::string_view> regions) -> sudoku_board
+auto sudoku_board::houses() const -> const std::vector<std::vector<u16>>&
+{
+    return d_houses;
+}
+
+auto sudoku_board::peers(u64 index) const -> std::span<const u16>
+{
+    assert(index < d_peers.size());
+    return d_peers[index];
+}
+
+auto sudoku_board::geometry() const -> int
+{
+    return d_geometry;
+}
+
+auto sudoku_board::first_column_house() const -> u64
+{
+    return d_first_column_house;
+}
+
+auto sudoku_board::first_region_house() const -> u64
+{
+    return d_first_region_house;
+}
+
+auto sudoku_board::first_extra_house() const -> u64
+{
+    return d_first_extra_house;
+}
+
+auto sudoku_board::with_values(std::span<const i32> values) const -> sudoku_board
+{
+    assert(values.size() == d_cells.size());
+    auto board = sudoku_board{d_size};
+    board.d_digits = d_digits;
+    board.d_cells = d_cells;
+    board.d_houses = d_houses;
+    board.d_peers = d_peers;
+    board.d_geometry = d_geometry;
+    board.d_first_column_house = d_first_column_house;
+    board.d_first_region_house = d_first_region_house;
+    board.d_first_extra_house = d_first_extra_house;
+    board.d_grids = d_grids;
+    board.constraints = constraints;
+    for (std::size_t i = 0; i != values.size(); ++i) {
+        auto& cell = board.d_cells[i];
+        if (values[i] != 0) {
+            cell.value = values[i];
+        } else {
+            cell.value = std::nullopt;
+        }
+        cell.fixed = values[i] != 0;
+    }
+    return board;
+}
+
+auto sudoku_board::build_houses() -> void
+{
+    d_houses.clear();
+    const auto n = static_cast<i32>(d_size);
+    const auto index = [&](i32 x, i32 y) { return static_cast<u16>(x + y * n); };
+    const auto digits = static_cast<i32>(d_digits);
+    for (const auto grid : d_grids) {
+        for (i32 y = 0; y != digits; ++y) {
+            auto& row = d_houses.emplace_back();
+            for (i32 x = 0; x != digits; ++x) row.push_back(index(grid.x + x, grid.y + y));
+        }
+    }
+    d_first_column_house = d_houses.size();
+    for (const auto grid : d_grids) {
+        for (i32 x = 0; x != digits; ++x) {
+            auto& col = d_houses.emplace_back();
+            for (i32 y = 0; y != digits; ++y) col.push_back(index(grid.x + x, grid.y + y));
+        }
+    }
+    d_first_region_house = d_houses.size();
+    auto regions = std::map<i32, std::vector<u16>>{};
+    for (std::size_t i = 0; i != d_cells.size(); ++i) {
+        if (d_cells[i].region.has_value()) regions[*d_cells[i].region].push_back(static_cast<u16>(i));
+    }
+    for (auto& [region, cells] : regions) {
+        d_houses.push_back(std::move(cells));
+    }
+
+    d_first_extra_house = d_houses.size();
+    if (d_geometry & diagonal) {
+        auto& down = d_houses.emplace_back();
+        auto& up = d_houses.emplace_back();
+        for (i32 i = 0; i != n; ++i) {
+            down.push_back(index(i, i));
+            up.push_back(index(n - 1 - i, i));
+        }
+    }
+
+    // make_board has checked that these boards are made of square boxes
+    const auto box = static_cast<i32>(std::lround(std::sqrt(static_cast<f64>(d_size))));
+    if (d_geometry & disjoint_groups) {
+        for (i32 spot = 0; spot != n; ++spot) {
+            auto& group = d_houses.emplace_back();
+            for (i32 b = 0; b != n; ++b) {
+                group.push_back(index((b % box) * box + spot % box, (b / box) * box + spot / box));
+            }
+        }
+    }
+    if (d_geometry & windoku) {
+        for (i32 top = 1; top + box < n; top += box + 1) {
+            for (i32 left = 1; left + box < n; left += box + 1) {
+                auto& window = d_houses.emplace_back();
+                for (i32 i = 0; i != n; ++i) window.push_back(index(left + i % box, top + i / box));
+            }
+        }
+    }
+
+    d_peers.assign(d_cells.size(), {});
+    for (const auto& house : d_houses) {
+        for (const auto a : house) {
+            for (const auto b : house) {
+                if (a != b) d_peers[a].push_back(b);
+            }
+        }
+    }
+
+    // The move rules relate pairs of cells rather than whole houses, so they only add peers
+    const auto add_moves = [&](std::span<const glm::ivec2> moves) {
+        for (i32 y = 0; y != n; ++y) {
+            for (i32 x = 0; x != n; ++x) {
+                for (const auto move : moves) {
+                    const auto to = glm::ivec2{x, y} + move;
+                    if (valid(to)) d_peers[index(x, y)].push_back(index(to.x, to.y));
+                }
+            }
+        }
+    };
+    if (d_geometry & anti_knight) {
+        static constexpr glm::ivec2 knight[] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+        add_moves(knight);
+    }
+    if (d_geometry & anti_king) {
+        static constexpr glm::ivec2 king[] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}, {0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+        add_moves(king);
+    }
+    for (auto& peers : d_peers) {
+        std::ranges::sort(peers);
+        const auto [first, last] = std::ranges::unique(peers);
+        peers.erase(first, last);
+    }
+}
+
+auto sudoku_board::make_board(std::vector<std::string_view> cells, std::vector<std::string_view> regions, int geometry) -> sudoku_board
 {
     const auto size = cells.size();
+    if (size > max_board_size) {
+        std::print("make_board failed - boards can be at most {}x{}\n", max_board_size, max_board_size);
+        std::exit(1);
+    }
     if (regions.size() != size) {
         std::print("make_board failed - regions don't align\n");
         std::exit(1);
     }
-    for (const auto& row : cells) {
-        if (row.size() != size) {
+    for (std::size_t y = 0; y != size; ++y) {
+        if (cells[y].size() != size || regions[y].size() != size) {
             std::print("make_board failed - not a square!\n");
             std::exit(1);
         }
@@ -296,12 +572,106 @@ auto sudoku_board::make_board(std::vector<std::string_view> cells, std::vector<s
         const auto& row = cells[y];
         for (int x = 0; x != row.size(); ++x) {
             if (row[x] != '.') {
-                board.get({x, y}).value = static_cast<int>(row[x] - '0');
+                const auto value = parse_symbol(row[x]);
+                if (!value || *value < 1 || *value > size) {
+                    std::print("make_board failed - '{}' is not a digit on a {}x{} board\n", row[x], size, size);
+                    std::exit(1);
+                }
+                board.get({x, y}).value = *value;
                 board.get({x, y}).fixed = true;
             }
-            board.get({x, y}).region = static_cast<i32>(regions[y][x] - '0');
+            const auto region = parse_symbol(regions[y][x]);
+            if (!region) {
+                std::print("make_board failed - '{}' is not a region\n", regions[y][x]);
+                std::exit(1);
+            }
+            board.get({x, y}).region = *region;
+        }
+    }
+    const auto box = static_cast<u64>(std::lround(std::sqrt(static_cast<f64>(size))));
+    if ((geometry & (disjoint_groups | windoku)) && box * box != size) {
+        std::print("make_board failed - disjoint groups and windoku need square boxes\n");
+        std::exit(1);
+    }
+    board.d_geometry = geometry;
+    board.build_houses();
+    return board;
+}
+
+auto sudoku_board::make_multi_board(std::vector<std::string_view> cells, u64 digits, std::vector<glm::ivec2> grids) -> sudoku_board
+{
+    const auto box = static_cast<i32>(std::lround(std::sqrt(static_cast<f64>(digits))));
+    if (digits < 4 || static_cast<u64>(box * box) != digits) {
+        std::print("make_multi_board failed - grids need square boxes\n");
+        std::exit(1);
+    }
+    if (grids.empty()) {
+        std::print("make_multi_board failed - no grids\n");
+        std::exit(1);
+    }
+
+    // The boxes of every grid line up so that an overlap is made of whole boxes
+    auto extent = i32{0};
+    for (const auto grid : grids) {
+        if (grid.x < 0 || grid.y < 0 || grid.x % box != 0 || grid.y % box != 0) {
+            std::print("make_multi_board failed - grid at ({}, {}) is not on a box boundary\n", grid.x, grid.y);
+            std::exit(1);
+        }
+        extent = std::max({extent, grid.x + box * box, grid.y + box * box});
+    }
+    if (static_cast<u64>(extent) > max_board_size) {
+        std::print("make_multi_board failed - the grids span more than {}x{} cells\n", max_board_size, max_board_size);
+        std::exit(1);
+    }
+    if (cells.size() > static_cast<u64>(extent)) {
+        std::print("make_multi_board failed - there are more rows than the grids cover\n");
+        std::exit(1);
+    }
+
+    auto board = sudoku_board{static_cast<u64>(extent)};
+    board.d_digits = digits;
+    board.d_grids = std::move(grids);
+    for (auto& cell : board.d_cells) cell.active = false;
+    for (const auto grid : board.d_grids) {
+        for (i32 y = grid.y; y != grid.y + box * box; ++y) {
+            for (i32 x = grid.x; x != grid.x + box * box; ++x) {
+                auto& cell = board.get({x, y});
+                cell.active = true;
+                cell.region = x / box + (y / box) * (extent / box);
+            }
+        }
+    }
+
+    for (int y = 0; y != cells.size(); ++y) {
+        const auto& row = cells[y];
+        if (row.size() > static_cast<u64>(extent)) {
+            std::print("make_multi_board failed - row {} is wider than the grids\n", y);
+            std::exit(1);
+        }
+        for (int x = 0; x != row.size(); ++x) {
+            auto& cell = board.get({x, y});
+            if (row[x] == ' ') {
+                if (cell.active) {
+                    std::print("make_multi_board failed - ({}, {}) is inside a grid but is ' '\n", x, y);
+                    std::exit(1);
+                }
+                continue;
+            }
+            if (!cell.active) {
+                std::print("make_multi_board failed - ({}, {}) is outside every grid\n", x, y);
+                std::exit(1);
+            }
+            if (row[x] == '.') continue;
+            const auto value = parse_symbol(row[x]);
+            if (!value || *value < 1 || *value > digits) {
+                std::print("make_multi_board failed - '{}' is not a digit on a {}x{} grid\n", row[x], digits, digits);
+                std::exit(1);
+            }
+            cell.value = *value;
+            cell.fixed = true;
         }
     }
+    board.build_houses();
     return board;
 }
 
@@ -5,24 +5,43 @@
 
 #include <optional>
 #include <vector>
-#include <unordered_set>
 #include <set>
 #include <span>
 #include <memory>
 #include <string_view>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 #include <glm/glm.hpp>
 
 namespace sudoku {
 
+// Boards larger than 9x9 write the digits after 9 as letters, so 10 is 'A', 16 is 'G'
+// and 25 is 'P'. Regions use the same alphabet, with '0' also allowed.
+static constexpr u64 max_board_size = 35;
+
+auto parse_symbol(char c) -> std::optional<i32>;
+auto to_symbol(i32 value) -> char;
+
+// Rules that make more cells see each other. They become extra houses and peers when the
+// board is built, so the solvers treat them exactly like rows and columns.
+enum geometry // not an enum class because they can be | together
+{
+    diagonal        = 1 << 0, // both long diagonals are houses
+    anti_knight     = 1 << 1, // cells a knight's move apart see each other
+    anti_king       = 1 << 2, // cells a king's move apart see each other
+    disjoint_groups = 1 << 3, // the cells in the same spot of every box form a house
+    windoku         = 1 << 4, // the boxes set one cell in from each box corner are houses
+};
+
+// Top left cells of the five 9x9 grids of a Samurai, which is 21x21 cells across
+auto samurai_grids() -> std::vector<glm::ivec2>;
+
 struct sudoku_cell
 {
     std::optional<i32> value = {};
     bool               fixed = false;
     std::optional<i32> region = {};
     bool               selected = false;
+    bool               active = true; // false for the gaps between the grids of a multi-grid board
 
     std::set<i32> corner_pencil_marks;
     std::set<i32> centre_pencil_marks;
@@ -35,12 +54,33 @@ struct sudoku_region
 
 class sudoku_board
 {
-    u64                                      d_size;
+    u64                                      d_size;   // width of the cell array
+    u64                                      d_digits; // digits in each house, equal to d_size unless the board has several grids
     std::vector<sudoku_cell>                 d_cells;
     solve_history                            d_history;
 
+    // Cell indices (x + y * size) of every house (rows, columns, regions and then the
+    // houses added by the geometry), and for each cell the sorted indices of all cells
+    // sharing a house or a geometry rule with it
+    std::vector<std::vector<u16>>            d_houses;
+    std::vector<std::vector<u16>>            d_peers;
+    int                                      d_geometry = 0;
+    u64                                      d_first_column_house = 0;
+    u64                                      d_first_region_house = 0;
+    u64                                      d_first_extra_house = 0;
+
+    // Top left cell of each digits x digits grid. A plain board is one grid at the origin,
+    // while a Samurai is five that share their corner boxes.
+    std::vector<glm::ivec2>                  d_grids;
+
+    // When set, placing a digit also erases that digit's pencil marks from the cell's peers
+    bool                                     d_auto_candidates = false;
+
     auto get(glm::ivec2 pos) -> sudoku_cell&;
-    auto for_each_selected(const std::function<void(int, int, sudoku_cell&)>& fn); // TODO: Replace with function_ref
+    auto get(cell_index cell) -> sudoku_cell&;
+    auto build_houses() -> void;
+    auto remove_peer_marks(u64 index, i32 value, edit_event& event) -> void;
+    auto for_each_selected(const std::function<void(cell_index, sudoku_cell&)>& fn); // TODO: Replace with function_ref
 
 public:
     std::vector<std::shared_ptr<constraint>> constraints; // TODO - make private
@@ -48,14 +88,24 @@ public:
     sudoku_board(u64 size);
 
     auto at(glm::ivec2 pos) const -> const sudoku_cell&;
+    auto at(cell_index cell) const -> const sudoku_cell&;
+
+    // Conversions between positions and cell indices, positions are looked up in a table
+    // shared by every board of the same size
+    auto index_of(glm::ivec2 pos) const -> cell_index;
+    auto position_of(cell_index cell) const -> glm::ivec2;
 
     // Selection API
     auto select(glm::ivec2 pos, bool value) -> void;
+    auto select(cell_index cell, bool value) -> void;
     auto toggle_selected(glm::ivec2 pos) -> void;
+    auto toggle_selected(cell_index cell) -> void;
     void unselect_all();
 
     // Modify the selected cells
     void set_digit(i32 value);
+    void set_auto_candidates(bool enabled);
+    auto auto_candidates() const -> bool;
     void set_corner_pencil_mark(i32 value);
     void set_centre_pencil_mark(i32 value);  
     
@@ -68,12 +118,40 @@ public:
     void undo();
     void redo();
 
+    // Applies an edit made outside of the selection API, such as a solver step, without
+    // touching the history. Pass the same diffs to record() to make them undoable.
+    void apply(const diff& d);
+    void record(const edit_event& event);
+
     auto size() const -> u64;
+    auto digits() const -> u64;
+    auto grids() const -> std::span<const glm::ivec2>;
     auto valid(glm::ivec2 pos) const -> bool;
+    auto valid(cell_index cell) const -> bool;
 
     auto cells() const -> const std::vector<sudoku_cell>&;
+    auto houses() const -> const std::vector<std::vector<u16>>&;
+    auto peers(u64 index) const -> std::span<const u16>;
+    auto geometry() const -> int;
+
+    // The houses are the rows of every grid, then the columns of every grid, then the
+    // regions, then the houses added by the geometry
+    auto first_column_house() const -> u64;
+    auto first_region_house() const -> u64;
+    auto first_extra_house() const -> u64;
+
+    // Returns a copy of the board with every cell's digit replaced and the filled cells
+    // marked as givens. Values of 0 leave the cell empty.
+    auto with_values(std::span<const i32> values) const -> sudoku_board;
     
-    static auto make_board(std::vector<std::string_view> cells, std::vector<std::string_view> regions) -> sudoku_board;
+    // geometry is any of the geometry rules | together
+    static auto make_board(std::vector<std::string_view> cells, std::vector<std::string_view> regions, int geometry = 0) -> sudoku_board;
+
+    // A board of several overlapping grids, each digits x digits with square boxes, whose
+    // top left cells are given by grids. Every grid's rows, columns and boxes are houses
+    // over one shared cell array, so the cells in an overlap belong to each grid at once.
+    // Cells outside every grid are ' ', and short rows are padded with them.
+    static auto make_multi_board(std::vector<std::string_view> cells, u64 digits, std::vector<glm::ivec2> grids) -> sudoku_board;
 };
 
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "camera.hpp"
 #include "input.hpp"
 #include "window.hpp"
+#include "rng.hpp"
 
 #include <array>
 #include <random>
@@ -43,20 +44,17 @@ auto timer::now() const -> clock::time_point
 
 auto random_from_range(float min, float max) -> float
 {
-    static std::default_random_engine gen;
-    return std::uniform_real_distribution(min, max)(gen);
+    return std::uniform_real_distribution(min, max)(thread_rng());
 }
 
 auto random_from_range(int min, int max) -> int
 {
-    static std::default_random_engine gen;
-    return std::uniform_int_distribution(min, max)(gen);
+    return std::uniform_int_distribution(min, max)(thread_rng());
 }
 
 auto random_normal(float centre, float sd) -> float
 {
-    static std::default_random_engine gen;
-    return std::normal_distribution(centre, sd)(gen);
+    return std::normal_distribution(centre, sd)(thread_rng());
 }
 
 auto random_from_circle(float radius) -> glm::ivec2
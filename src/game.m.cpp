@@ -6,19 +6,22 @@
 #include "ui.hpp"
 #include "sudoku.hpp"
 #include "draw_board.hpp"
+#include "solver.hpp"
+#include "solver_stats.hpp"
+#include "step_solver.hpp"
+#include "incremental_solver.hpp"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
-#include <glm/gtx/hash.hpp>
 
 #include <format>
+#include <fstream>
 #include <print>
 #include <initializer_list>
 #include <string>
 #include <optional>
 #include <unordered_map>
-#include <unordered_set>
 
 enum class next_state
 {
@@ -29,14 +32,18 @@ enum class next_state
 
 constexpr auto clear_colour = sudoku::from_hex(0x222f3e);
 
+// How many solver edits "Watch Solve" shows each frame
+constexpr auto watch_steps_per_frame = 4;
+
 namespace sudoku {
 
 auto hovered_cell_pos(const sudoku_board& board, const window& w) -> std::optional<glm::ivec2>
 {
     const auto mouse_pos = w.mouse_pos();
     
-    const auto board_size = 0.9 * std::min(w.width(), w.height());
-    const auto cell_size = board_size / board.size();
+    const auto margin = board_margin(board);
+    const auto cell_size = 0.9 * std::min(w.width(), w.height()) / (board.size() + 2 * margin);
+    const auto board_size = cell_size * board.size();
 
     auto top_left = glm::ivec2{w.width() / 2, w.height() / 2};
     top_left.x -= board_size / 2;
@@ -53,63 +60,63 @@ auto hovered_cell_pos(const sudoku_board& board, const window& w) -> std::option
     return {};
 }
 
+// A cell and its digit to fill in next. The analysis keeps its state between hints, so
+// only the edits made since the last one are propagated.
+auto find_hint(const sudoku_board& board, incremental_solver& analysis) -> std::optional<std::pair<u16, i32>>
+{
+    analysis.sync(board);
+    if (!analysis.consistent()) {
+        std::print("no hint - the digits on the board contradict each other\n");
+        return {};
+    }
+    if (const auto hint = analysis.hint()) return hint;
+
+    // Nothing follows directly, so give a cell from a solution instead
+    const auto& result = analysis.solve();
+    if (!result) {
+        std::print("no hint - the board has no solution\n");
+        return {};
+    }
+    const auto& cells = board.cells();
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (cells[i].active && !cells[i].value) return std::pair{static_cast<u16>(i), (*result)[i]};
+    }
+    return {};
+}
+
 auto check_solution(const sudoku_board& board, time_point time) -> board_render_state
 {
     auto empty_cells = empty_cells_rs{};
     empty_cells.time = time;
 
     // check for empty cells
-    for (i32 row = 0; row != board.size(); ++row) {
-        for (i32 col = 0; col != board.size(); ++col) {
-            const auto val = board.at({row, col}).value;
-            if (!val.has_value()) empty_cells.cells.insert(glm::ivec2{row, col});
-        }
+    const auto& cells = board.cells();
+    for (std::size_t i = 0; i != cells.size(); ++i) {
+        if (cells[i].active && !cells[i].value.has_value()) empty_cells.cells.set(i);
     }
-    if (!empty_cells.cells.empty()) { // bad solution because the board isn't filled
+    if (empty_cells.cells.any()) { // bad solution because the board isn't filled
         return empty_cells;
     }
 
-    // check rows
-    for (i32 row = 0; row != board.size(); ++row) {
-        std::unordered_set<i32> seen; 
-        for (i32 col = 0; col != board.size(); ++col) {
-            const auto val = board.at({row, col}).value;
-            seen.insert(*val);
-        }
-        if (seen.size() != board.size()) return constraint_faiure_rs{}; // duplicate values in the row
-    }
-
-    // check columns
-    for (i32 col = 0; col != board.size(); ++col) {
-        std::unordered_set<i32> seen; 
-        for (i32 row = 0; row != board.size(); ++row) {
-            const auto val = board.at({row, col}).value;
-            seen.insert(*val);
-        }
-        if (seen.size() != board.size()) return constraint_faiure_rs{}; // duplicate values in the row
+    if (!is_solved(board)) {
+        return constraint_faiure_rs{};
     }
 
-    // check regions
-    std::unordered_map<i32, std::unordered_set<i32>> regions;
-    for (i32 row = 0; row != board.size(); ++row) {
-        for (i32 col = 0; col != board.size(); ++col) {
-            if (board.at({row, col}).region.has_value()) {
-                regions[*board.at({row, col}).region].insert(*board.at({row, col}).value);
-            }
-        }
-    }
-    for (const auto& [region, seen] : regions) {
-        if (seen.size() != board.size()) return constraint_faiure_rs{};
-    }
+    return solved_rs{ .time = time };
+}
 
-    // check constraints
-    for (const auto& c : board.constraints) {
-        if (!c->check(board)) {
-            return constraint_faiure_rs{};
-        }
+// Solves the current board with stats enabled and writes them out as JSON
+auto export_solver_stats(const sudoku_board& board) -> void
+{
+    auto stats = solver_stats{};
+    {
+        const auto scope = stats_scope{stats};
+        solve(board);
+        count_solutions(board, 2);
     }
-
-    return solved_rs{ .time = time };
+    auto file = std::ofstream{"solver_stats.json"};
+    file << stats.to_json();
+    std::print("wrote solver stats to solver_stats.json\n");
 }
 
 }
@@ -254,9 +261,49 @@ auto scene_game(sudoku::window& window) -> next_state
         }
     );
     board.constraints.emplace_back(std::make_shared<german_whisper>(std::vector<glm::ivec2>{{0, 0}, {1, 0}, {1, 1}}));
+#elif LEVEL == 4
+    auto board = sudoku_board::make_board(
+        {
+            "3...2.F15...CG..",
+            "1....CD..6.F89.E",
+            "6.B.3..789....DF",
+            "...G.8....4.....",
+            ".7...58B.A6.....",
+            "CD..F....B.8...1",
+            "F......4E.3D.8..",
+            "...8A..6.1..4...",
+            ".......9C8G....D",
+            "..2.17.....B.E.G",
+            "95...FB.A3DE..14",
+            ".B...3.E.5...7..",
+            "5..2...3......F.",
+            "...B..1....9.CG.",
+            "EF....4.D.2...9.",
+            ".CD...E.7...6..."
+        }, {
+            "0000111122223333",
+            "0000111122223333",
+            "0000111122223333",
+            "0000111122223333",
+            "4444555566667777",
+            "4444555566667777",
+            "4444555566667777",
+            "4444555566667777",
+            "88889999AAAABBBB",
+            "88889999AAAABBBB",
+            "88889999AAAABBBB",
+            "88889999AAAABBBB",
+            "CCCCDDDDEEEEFFFF",
+            "CCCCDDDDEEEEFFFF",
+            "CCCCDDDDEEEEFFFF",
+            "CCCCDDDDEEEEFFFF"
+        }
+    );
 #endif
 
     std::optional<bool> mouse_down = {};
+    std::optional<step_solver> watch = {};
+    auto analysis = incremental_solver{board};
     while (window.is_running()) {
         const double dt = timer.on_update();
         window.begin_frame(clear_colour);
@@ -272,6 +319,9 @@ auto scene_game(sudoku::window& window) -> next_state
             if (std::holds_alternative<solved_rs>(state)) {
                 continue; // Don't allow updating the board when it's solved
             }
+            if (watch.has_value()) {
+                continue; // or while the solver is playing out
+            }
 
             if (const auto e = event.get_if<mouse_pressed_event>()) {
                 const auto pos = hovered_cell_pos(board, window);
@@ -330,9 +380,17 @@ auto scene_game(sudoku::window& window) -> next_state
                     case keyboard::num_7: value = 7; break;
                     case keyboard::num_8: value = 8; break;
                     case keyboard::num_9: value = 9; break;
+                    default: {
+                        // letters are the digits after 9 on larger boards
+                        const auto key = static_cast<i32>(e->key);
+                        const auto a = static_cast<i32>(keyboard::A);
+                        if (a <= key && key <= static_cast<i32>(keyboard::Z)) {
+                            value = 10 + key - a;
+                        }
+                    } break;
                 }
                 if (!value) continue; // keyboard input was not a digit
-                if (*value > board.size()) continue; // not a digit in the grid
+                if (*value > board.digits()) continue; // not a digit in the grid
 
                 if (e->mods & modifier::ctrl) {
                     board.set_centre_pencil_mark(*value);
@@ -360,6 +418,10 @@ auto scene_game(sudoku::window& window) -> next_state
             }
         }
 
+        if (watch.has_value() && !watch->advance(board, watch_steps_per_frame)) {
+            watch.reset();
+        }
+
         draw_board(renderer, {window.width(), window.height()}, board, state, timer.now());
         
         if (ui.button("Back", {0, 0}, 200, 50, 3)) {
@@ -373,6 +435,29 @@ auto scene_game(sudoku::window& window) -> next_state
             }
         }
 
+        if (ui.button("Solver Stats", {0, 110}, 200, 50, 3)) {
+            export_solver_stats(board);
+        }
+
+        if (!watch.has_value() && ui.button("Watch Solve", {0, 165}, 200, 50, 3)) {
+            board.unselect_all();
+            watch.emplace(board);
+        }
+
+        if (!watch.has_value() && ui.button("Hint", {0, 275}, 200, 50, 3)) {
+            if (const auto hint = find_hint(board, analysis)) {
+                const auto [cell, digit] = *hint;
+                board.unselect_all();
+                board.select(cell_index{cell}, true);
+                board.set_digit(digit);
+            }
+        }
+
+        const auto auto_label = board.auto_candidates() ? "Auto Marks: On" : "Auto Marks: Off";
+        if (ui.button(auto_label, {0, 220}, 200, 50, 3)) {
+            board.set_auto_candidates(!board.auto_candidates());
+        }
+
         ui.end_frame(dt);
         renderer.draw(window.width(), window.height());
         window.end_frame();